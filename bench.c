@@ -0,0 +1,260 @@
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "shellgibi.h"
+
+// microbenchmarks for the parser, path resolution, completion, globbing, directory jumping and copies on a synthetic PATH
+#define BENCH_MIN_SECONDS 0.5
+#define JUMP_BENCH_DIRS 30000
+
+static char root[] = "/tmp/shellgibi-bench-XXXXXX";
+static int num_dirs = 20, files_per_dir = 500;
+
+static double now() {
+    return monotonic_ns() / 1e9;
+}
+
+/**
+ * Create num_dirs directories with files_per_dir executables each and point PATH at them
+ */
+static void make_path() {
+    if (mkdtemp(root) == NULL) {
+        perror("mkdtemp");
+        exit(1);
+    }
+    size_t size = num_dirs * (strlen(root) + 16) + 1;
+    PATH = malloc(size);
+    PATH[0] = 0;
+    char name[512];
+    for (int d = 0; d < num_dirs; d++) {
+        snprintf(name, sizeof(name), "%s/bin%d", root, d);
+        mkdir(name, 0755);
+        if (d > 0) strcat(PATH, ":");
+        strcat(PATH, name);
+        for (int f = 0; f < files_per_dir; f++) {
+            snprintf(name, sizeof(name), "%s/bin%d/cmd%d_%d", root, d, d, f);
+            close(open(name, O_CREAT | O_WRONLY, 0755));
+        }
+    }
+}
+
+static void remove_path() {
+    char name[512];
+    for (int d = 0; d < num_dirs; d++) {
+        for (int f = 0; f < files_per_dir; f++) {
+            snprintf(name, sizeof(name), "%s/bin%d/cmd%d_%d", root, d, d, f);
+            unlink(name);
+        }
+        snprintf(name, sizeof(name), "%s/bin%d", root, d);
+        rmdir(name);
+    }
+    snprintf(name, sizeof(name), "%s/.shellgibi_dirs", root);
+    unlink(name);
+    snprintf(name, sizeof(name), "%s/shellgibi/commands", root);
+    unlink(name);
+    snprintf(name, sizeof(name), "%s/shellgibi", root);
+    rmdir(name);
+    rmdir(root);
+    free(PATH);
+}
+
+static void report(const char *name, long ops, double seconds) {
+    printf("%-28s %12.0f ns/op %10ld ops\n", name, seconds / ops * 1e9, ops);
+}
+
+/** parse the entries of a list, as run_list does right before running each */
+static void parse_entries(struct command_t *command) {
+    for (struct command_t *c = command; c; c = c->then) {
+        parse_entry(c);
+        parse_entries(c->group);
+    }
+}
+
+static void bench_parse(const char *name, const char *line) {
+    char buf[4096];
+    long ops = 0;
+    double start = now(), elapsed;
+    do {
+        for (int i = 0; i < 1000; i++, ops++) {
+            struct command_t *command = calloc(1, sizeof(struct command_t));
+            strcpy(buf, line);
+            parse_line(buf, command);
+            parse_entries(command);
+            free_command(command);
+        }
+    } while ((elapsed = now() - start) < BENCH_MIN_SECONDS);
+    report(name, ops, elapsed);
+}
+
+static void bench_run(const char *name, const char *line) {
+    char buf[4096];
+    long ops = 0;
+    double start = now(), elapsed;
+    do {
+        for (int i = 0; i < 10; i++, ops++) {
+            struct command_t *command = calloc(1, sizeof(struct command_t));
+            strcpy(buf, line);
+            parse_line(buf, command);
+            run_list(command);
+            free_command(command);
+        }
+    } while ((elapsed = now() - start) < BENCH_MIN_SECONDS);
+    report(name, ops, elapsed);
+}
+
+static void bench_resolve(const char *name, const char *cmd) {
+    long ops = 0;
+    double start = now(), elapsed;
+    do {
+        for (int i = 0; i < 100; i++, ops++)
+            free(resolve_command(cmd));
+    } while ((elapsed = now() - start) < BENCH_MIN_SECONDS);
+    report(name, ops, elapsed);
+}
+
+/** new_prompt: every lookup is the first of its line and stats the PATH directories */
+static void bench_suggest(const char *name, const char *cmd, bool new_prompt) {
+    const char *out[3];
+    long ops = 0;
+    refresh_command_index(); // build it outside the timing
+    double start = now(), elapsed;
+    do {
+        for (int i = 0; i < 100; i++, ops++) {
+            if (new_prompt)
+                expire_command_index();
+            suggest_commands(cmd, out, 3);
+        }
+    } while ((elapsed = now() - start) < BENCH_MIN_SECONDS);
+    report(name, ops, elapsed);
+}
+
+static void bench_jump(const char *name, char **fragments, int count) {
+    long ops = 0;
+    double start = now(), elapsed;
+    do {
+        for (int i = 0; i < 100; i++, ops++)
+            jump_find(fragments, count);
+    } while ((elapsed = now() - start) < BENCH_MIN_SECONDS);
+    report(name, ops, elapsed);
+}
+
+static void bench_glob(const char *name, const char *pattern) {
+    long ops = 0;
+    int count = 0;
+    double start = now(), elapsed;
+    do {
+        for (int i = 0; i < 10; i++, ops++) {
+            char **paths = glob_expand(pattern, &count);
+            for (int j = 0; j < count; j++)
+                free(paths[j]);
+            free(paths);
+        }
+    } while ((elapsed = now() - start) < BENCH_MIN_SECONDS);
+    report(name, ops, elapsed);
+}
+
+static void bench_onematch(const char *name, char *cmd) {
+    long ops = 0;
+    double start = now(), elapsed;
+    do {
+        for (int i = 0; i < 10; i++, ops++)
+            free(onematch(cmd));
+    } while ((elapsed = now() - start) < BENCH_MIN_SECONDS);
+    report(name, ops, elapsed);
+}
+
+static void bench_matches(const char *name, char *cmd) {
+    long ops = 0;
+    double start = now(), elapsed;
+    do {
+        for (int i = 0; i < 10; i++, ops++)
+            freeListOfMatchingCommands(getListOfMatchingCommands(cmd));
+    } while ((elapsed = now() - start) < BENCH_MIN_SECONDS);
+    report(name, ops, elapsed);
+}
+
+/**
+ * bench [dirs] [files per dir]
+ */
+int main(int argc, char *argv[]) {
+    if (argc > 1) num_dirs = atoi(argv[1]);
+    if (argc > 2) files_per_dir = atoi(argv[2]);
+    if (num_dirs <= 0 || files_per_dir <= 0) {
+        fprintf(stderr, "usage: %s [dirs] [files per dir]\n", argv[0]);
+        return 1;
+    }
+    make_path();
+    printf("synthetic PATH: %d dirs x %d files\n", num_dirs, files_per_dir);
+
+    bench_parse("parse simple", "ls -la /tmp");
+    bench_parse("parse pipe+redirects", "cat <in.txt | grep -v foo | sort >out.txt &");
+    bench_parse("parse list+group", "make -j8 && { ./test; echo done; } || echo failed >>log.txt");
+    bench_parse("parse many args", "echo a b c d e f g h i j k l m n o p q r s t u v w x y z");
+
+    char first[32], last[32];
+    snprintf(first, sizeof(first), "cmd0_0");
+    snprintf(last, sizeof(last), "cmd%d_%d", num_dirs - 1, files_per_dir - 1);
+    bench_resolve("resolve first dir", first);
+    bench_resolve("resolve last dir", last);
+    bench_resolve("resolve missing", "no_such_command");
+
+    // the completion index goes in the bench root, the first lookup builds it
+    setenv("XDG_CACHE_HOME", root, 1);
+    const char *found[1];
+    double start = now();
+    match_cached_commands("cmd", found, 1);
+    report("completion index build", 1, now() - start);
+
+    char unique[32], ambiguous[] = "cmd";
+    snprintf(unique, sizeof(unique), "cmd%d_%d", num_dirs - 1, files_per_dir - 1);
+    bench_onematch("onematch unique", unique);
+    bench_onematch("onematch ambiguous", ambiguous);
+    bench_matches("list matches", ambiguous);
+
+    char pattern[512];
+    snprintf(pattern, sizeof(pattern), "%s/bin*/cmd*_1?", root);
+    bench_glob("glob one level", pattern);
+    snprintf(pattern, sizeof(pattern), "%s/**/cmd1*_[0-4]", root);
+    bench_glob("glob recursive", pattern);
+
+    char typo[32];
+    snprintf(typo, sizeof(typo), "cmd%d_%dx", num_dirs / 2, files_per_dir / 2);
+    bench_suggest("suggest typo", typo, false);
+    bench_suggest("suggest typo, new prompt", typo, true);
+    bench_suggest("suggest far miss", "zzzzzzzzzz", false);
+
+    // the directory database goes in the bench root, filled with made up directories
+    setenv("HOME", root, 1);
+    char dir[256];
+    for (int i = 0; i < JUMP_BENCH_DIRS; i++) {
+        snprintf(dir, sizeof(dir), "/home/user/projects/project%d/src/module%d", i % 500, i);
+        for (int v = 0; v <= i % 4; v++)
+            jump_visit(dir);
+    }
+    char *one[] = {"module12345"}, *two[] = {"project7", "src"}, *miss[] = {"nowhere"};
+    bench_jump("jump one fragment", one, 1);
+    bench_jump("jump two fragments", two, 2);
+    bench_jump("jump no match", miss, 1);
+
+    // a small file copied by the shell, and by a cat process for comparison
+    char src[512], dst[512], line[1100], data[4096];
+    snprintf(src, sizeof(src), "%s/copy-src", root);
+    snprintf(dst, sizeof(dst), "%s/copy-dst", root);
+    memset(data, 'x', sizeof(data));
+    int fd = open(src, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    write(fd, data, sizeof(data));
+    close(fd);
+    snprintf(line, sizeof(line), "cat %s >%s", src, dst);
+    bench_run("copy in shell", line);
+    snprintf(line, sizeof(line), "/bin/cat %s >%s", src, dst);
+    bench_run("copy by cat process", line);
+    unlink(src);
+    unlink(dst);
+
+    remove_path();
+    return 0;
+}
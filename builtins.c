@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "shellgibi.h"
+
+// for todo
+
+/**
+ * Build the "<number>  <args...>" line todo and motivate store, in one allocation
+ * @param  number line number
+ * @param  args   words of the entry
+ * @param  count  number of words
+ * @return        malloc'd line
+ */
+char *numberedLine(int number, char **args, int count) {
+    size_t len = 32;
+    for (int i = 0; i < count; i++)
+        len += strlen(args[i]) + 1;
+    char *line = malloc(len);
+    char *p = line + sprintf(line, "%d ", number);
+    for (int i = 0; i < count; i++)
+        p += sprintf(p, " %s", args[i]);
+    return line;
+}
+
+int getCurrentLineNumber(char* filename) {
+    int x;
+    FILE *fp;
+    char tmp[1024];
+    fp = fopen(filename, "ab+");
+
+    tmp[0] = 0;
+    while (!feof(fp))
+        fgets(tmp, 1024, fp);
+    fclose(fp);
+
+    x = atoi(tmp);
+    return x;
+}
+
+bool StartsWith(const char *a, const char *b) {
+    if (strncmp(a, b, strlen(b)) == 0) return 1;
+    return 0;
+}
+
+void deleteLineFromFile(char* filename, char *lineno) {
+    int lno, ctr = 0;
+
+    FILE *fptr1, *fptr2;
+
+    char str[256], temp[] = "temp.txt";
+
+    fptr1 = fopen(filename, "r");
+    if (!fptr1) {
+        printf(" File not found or unable to open the input file!!\n");
+
+    }
+    fptr2 = fopen(temp, "w"); // open the temporary file in write mode
+    if (!fptr2) {
+        printf("Unable to open a temporary file to write!!\n");
+        fclose(fptr1);
+
+    }
+
+    while (!feof(fptr1)) {
+        strcpy(str, "\0");
+        fgets(str, 256, fptr1);
+        if (!feof(fptr1)) {
+
+
+            if (!StartsWith(str, lineno)) {
+                fprintf(fptr2, "%s", str);
+            }
+        }
+    }
+    fclose(fptr1);
+    fclose(fptr2);
+    remove(filename);
+    rename(temp, filename);
+
+}
+
+void printRandomline(char * filename) {
+    FILE *fp = fopen(filename, "ab+");
+    int N=0;
+    char str[150];
+
+    while (1) {
+        if (fgets(str, 150, fp) == NULL) break;
+        N++;
+    }
+    fseek(fp, 0, SEEK_SET); // reset fp
+    printf("there are %d lines", N);
+    if (N==0) {
+        printf("empty motivational file!\n");
+        fclose(fp);
+        return;
+    }
+    int randomNumber = rand() % N;
+    printf("random is %d\n", randomNumber);
+    int line = 0;
+    while (1) {
+        if (fgets(str, 150, fp) == NULL) break;
+        if (line == randomNumber) {
+            printf("%s\n", str);
+            break;
+        }
+        line++;
+    }
+    fclose(fp);
+}
@@ -0,0 +1,294 @@
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "shellgibi.h"
+
+// PATH commands for completion: a sorted table kept in a file that every shell maps as it is
+#define CACHE_MAGIC "SGCMDS1"
+
+struct cache_header {
+    char magic[8];
+    uint32_t dir_count, name_count;
+    uint32_t path_off;          // the PATH it was built for
+    uint32_t dirs_off;          // struct cache_dir[dir_count], in PATH order
+    uint32_t names_off;         // uint32_t[name_count], offsets of the command names in sorted order
+    uint32_t size;              // of the whole file, the last byte is the NUL of the last string
+};
+
+struct cache_dir {
+    int64_t sec, nsec;          // mtime before it was read, 0 if it didn't exist
+    uint32_t path_off;
+    uint32_t pad;
+};
+
+static char *cache;             // mapped from the file, or built here if it couldn't be written
+static size_t cache_size;
+static bool cache_is_mapped;
+
+static const char *cache_file() {
+    static char path[PATH_MAX];
+    char dir[PATH_MAX];
+    char *xdg = getenv("XDG_CACHE_HOME"), *home = getenv("HOME");
+    if (xdg != NULL && xdg[0] == '/')
+        snprintf(dir, sizeof(dir), "%s", xdg);
+    else if (home != NULL)
+        snprintf(dir, sizeof(dir), "%s/.cache", home);
+    else
+        return NULL;
+    snprintf(path, sizeof(path), "%s/shellgibi/commands", dir);
+    return path;
+}
+
+static void dir_mtime(const char *dir, int64_t *sec, int64_t *nsec) {
+    struct stat st;
+    if (stat(dir, &st) == -1) {
+        *sec = *nsec = 0;
+        return;
+    }
+    *sec = st.st_mtim.tv_sec;
+    *nsec = st.st_mtim.tv_nsec;
+}
+
+/**
+ * Is the table sound, for the current PATH, and no directory changed since it was built?
+ * Costs a stat per PATH directory. Every string offset is checked, the file is shared and anyone can
+ * write it, and with the last byte a NUL every string in bounds ends in bounds.
+ */
+static bool cache_valid(const char *c, size_t size) {
+    const struct cache_header *h = (const struct cache_header *) c;
+    if (size < sizeof(struct cache_header) || memcmp(h->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0
+        || h->size != size || c[size - 1] != 0 || h->path_off >= size
+        || h->dirs_off + (uint64_t) h->dir_count * sizeof(struct cache_dir) > size
+        || h->names_off + (uint64_t) h->name_count * sizeof(uint32_t) > size)
+        return false;
+    if (strcmp(c + h->path_off, PATH) != 0)
+        return false;
+    const uint32_t *names = (const uint32_t *) (c + h->names_off);
+    for (uint32_t i = 0; i < h->name_count; i++)
+        if (names[i] >= size)
+            return false;
+    const struct cache_dir *dirs = (const struct cache_dir *) (c + h->dirs_off);
+    for (uint32_t i = 0; i < h->dir_count; i++) {
+        int64_t sec, nsec;
+        if (dirs[i].path_off >= size)
+            return false;
+        dir_mtime(c + dirs[i].path_off, &sec, &nsec);
+        if (sec != dirs[i].sec || nsec != dirs[i].nsec)
+            return false;
+    }
+    return true;
+}
+
+static int compare_names(const void *a, const void *b) {
+    return strcmp(*(char **) a, *(char **) b);
+}
+
+/**
+ * Read every PATH directory into a new table
+ * @param  size_out [description]
+ * @return          malloc'd table
+ */
+static char *cache_build(size_t *size_out) {
+    char *pathCopy = strdup(PATH);
+    char **dirs = NULL, **names = NULL;
+    int dir_count = 0, name_count = 0, name_cap = 0;
+    size_t strings = strlen(PATH) + 1;
+    struct cache_dir *dir_info = NULL;
+
+    for (char *token = strtok(pathCopy, ":"); token; token = strtok(NULL, ":")) {
+        dirs = realloc(dirs, sizeof(char *) * (dir_count + 1));
+        dir_info = realloc(dir_info, sizeof(struct cache_dir) * (dir_count + 1));
+        dirs[dir_count] = token;
+        memset(&dir_info[dir_count], 0, sizeof(struct cache_dir));
+        // the mtime from before reading, so a change while we read shows up next time
+        dir_mtime(token, &dir_info[dir_count].sec, &dir_info[dir_count].nsec);
+        strings += strlen(token) + 1;
+        dir_count++;
+
+        DIR *dr = opendir(token);
+        if (dr == NULL)
+            continue;
+        struct dirent *de;
+        while ((de = readdir(dr)) != NULL) {
+            if (de->d_name[0] == '.' || de->d_type == DT_DIR)
+                continue;
+            if (name_count == name_cap) {
+                name_cap = name_cap ? name_cap * 2 : 1024;
+                names = realloc(names, sizeof(char *) * name_cap);
+            }
+            names[name_count++] = strdup(de->d_name);
+        }
+        closedir(dr);
+    }
+
+    // sorted and without the duplicates of commands that are in several directories
+    qsort(names, name_count, sizeof(char *), compare_names);
+    int unique = 0;
+    for (int i = 0; i < name_count; i++) {
+        if (unique > 0 && strcmp(names[unique - 1], names[i]) == 0) {
+            free(names[i]);
+            continue;
+        }
+        names[unique++] = names[i];
+        strings += strlen(names[i]) + 1;
+    }
+
+    size_t size = sizeof(struct cache_header) + sizeof(struct cache_dir) * dir_count
+                  + sizeof(uint32_t) * unique + strings;
+    char *c = calloc(1, size);
+    struct cache_header *h = (struct cache_header *) c;
+    memcpy(h->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    h->dir_count = dir_count;
+    h->name_count = unique;
+    h->dirs_off = sizeof(struct cache_header);
+    h->names_off = h->dirs_off + sizeof(struct cache_dir) * dir_count;
+    h->size = size;
+    size_t off = h->names_off + sizeof(uint32_t) * unique;
+
+    h->path_off = off;
+    strcpy(c + off, PATH);
+    off += strlen(PATH) + 1;
+    for (int i = 0; i < dir_count; i++) {
+        dir_info[i].path_off = off;
+        strcpy(c + off, dirs[i]);
+        off += strlen(dirs[i]) + 1;
+    }
+    memcpy(c + h->dirs_off, dir_info, sizeof(struct cache_dir) * dir_count);
+    uint32_t *offsets = (uint32_t *) (c + h->names_off);
+    for (int i = 0; i < unique; i++) {
+        offsets[i] = off;
+        strcpy(c + off, names[i]);
+        off += strlen(names[i]) + 1;
+        free(names[i]);
+    }
+
+    free(names);
+    free(dirs);
+    free(dir_info);
+    free(pathCopy);
+    *size_out = size;
+    return c;
+}
+
+/** make the directories of the cache file */
+static void make_parents(const char *file) {
+    char dir[PATH_MAX];
+    snprintf(dir, sizeof(dir), "%s", file);
+    for (char *p = dir + 1; *p; p++) {
+        if (*p != '/')
+            continue;
+        *p = 0;
+        mkdir(dir, S_IRWXU);
+        *p = '/';
+    }
+}
+
+/** write the table next to the cache file and rename it over, so readers see the old or the new one */
+static void cache_write(const char *c, size_t size) {
+    const char *file = cache_file();
+    if (file == NULL)
+        return;
+    char tmp[PATH_MAX + 16];
+    snprintf(tmp, sizeof(tmp), "%s.%d", file, getpid());
+    make_parents(file);
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (fd == -1)
+        return;
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = write(fd, c + done, size - done);
+        if (n == -1 && errno == EINTR) continue;
+        if (n <= 0) break;
+        done += n;
+    }
+    close(fd);
+    if (done != size || rename(tmp, file) == -1)
+        unlink(tmp);
+}
+
+static void cache_drop() {
+    if (cache_is_mapped)
+        munmap(cache, cache_size);
+    else
+        free(cache);
+    cache = NULL;
+    cache_size = 0;
+}
+
+/**
+ * Make sure we have an up to date table: the one we have, the one in the file, or a new one
+ * @return false if there is none
+ */
+static bool cache_load() {
+    if (cache != NULL && cache_valid(cache, cache_size))
+        return true;
+    cache_drop();
+
+    // another shell may have rebuilt it already
+    const char *file = cache_file();
+    int fd = file ? open(file, O_RDONLY | O_CLOEXEC) : -1;
+    if (fd != -1) {
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            char *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (map != MAP_FAILED && cache_valid(map, st.st_size)) {
+                cache = map;
+                cache_size = st.st_size;
+                cache_is_mapped = true;
+            } else if (map != MAP_FAILED)
+                munmap(map, st.st_size);
+        }
+        close(fd);
+        if (cache != NULL)
+            return true;
+    }
+
+    cache = cache_build(&cache_size);
+    cache_is_mapped = false;
+    cache_write(cache, cache_size);
+    return true;
+}
+
+static const char *cache_name(uint32_t i) {
+    const struct cache_header *h = (const struct cache_header *) cache;
+    return cache + ((const uint32_t *) (cache + h->names_off))[i];
+}
+
+/**
+ * Find the PATH commands starting with a prefix
+ * @param  prefix [description]
+ * @param  out    filled with the first max of them in sorted order, valid until the next call
+ * @param  max    [description]
+ * @return        how many there are in all
+ */
+int match_cached_commands(const char *prefix, const char **out, int max) {
+    if (PATH == NULL || !cache_load())
+        return 0;
+    uint32_t lo = 0, hi = ((struct cache_header *) cache)->name_count;
+    size_t len = strlen(prefix);
+    while (lo < hi) { // first name not below the prefix
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (strcmp(cache_name(mid), prefix) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    uint32_t first = lo;
+    hi = ((struct cache_header *) cache)->name_count;
+    while (lo < hi) { // first name after it that doesn't start with it
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (strncmp(cache_name(mid), prefix, len) == 0) lo = mid + 1;
+        else hi = mid;
+    }
+    int count = lo - first;
+    for (int i = 0; i < count && i < max; i++)
+        out[i] = cache_name(first + i);
+    return count;
+}
@@ -0,0 +1,79 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "shellgibi.h"
+
+const int MAX_MATCHES_AUTOCOMPLETE = 40;
+char* userMethods[NUMUSERMETHODS] = {"alarm", "myjobs", "mybg", "myfg", "pause", "motivate", "jobstats", "profile", "xargs", "j", "every", "meter", "limit"};
+
+void printArray(char **a) {
+    printf("\n");
+    for (int i = 0; i < MAX_MATCHES_AUTOCOMPLETE; i++) {
+        if (a[i] == NULL) {
+            printf("\nprinted all matches\n");
+            break;
+        }
+        printf("%s\n", a[i]);
+    }
+}
+
+char *onematch(char *cmd) {
+    //printf("\ngetting onematch of %s\n", cmd);
+    const char *found[1];
+    int numMatch = match_cached_commands(cmd, found, 1);
+    char *match = numMatch > 0 ? strdup(found[0]) : NULL;
+
+    for (int i=0; i<NUMUSERMETHODS; i++){
+        if (prefix(cmd, userMethods[i])) {
+            //printf("got a match! %s\n", de->d_name);
+            if (match == NULL)
+                match = strdup(userMethods[i]);
+            else if (strcmp(match, userMethods[i]) == 0)
+                continue; // a builtin that is also in PATH, like xargs
+            numMatch++;
+        }
+    }
+    if (numMatch == 1) {
+        //printf("\ngot one match, %s\n", match);
+        return match;
+    }
+    free(match);
+    return NULL;
+}
+
+char **getListOfMatchingCommands(char *cmd) {
+    //printf("\nGetting list of matching commands\n");
+    //printf("checking for equality %s.\n", cmd);
+    int matchCount = 0;
+    char **matches = malloc(MAX_MATCHES_AUTOCOMPLETE * sizeof(char *));
+    const char *found[MAX_MATCHES_AUTOCOMPLETE];
+
+
+    // check for user defined methods
+
+    for (int i=0; i<NUMUSERMETHODS; i++){
+        if (prefix(cmd, userMethods[i])) {
+            //printf("got a match! %s\n", de->d_name);
+            matches[matchCount++] = strdup(userMethods[i]);
+        }
+    }
+
+    int n = match_cached_commands(cmd, found, MAX_MATCHES_AUTOCOMPLETE - 1 - matchCount);
+    for (int i = 0; i < n && matchCount < MAX_MATCHES_AUTOCOMPLETE - 1; i++)
+        matches[matchCount++] = strdup(found[i]);
+    matches[matchCount] = NULL;
+    //printf("\nPrinting array in method\n");
+    //printArray(matches);
+    return matches;
+
+}
+
+/**
+ * Release a NULL terminated list from getListOfMatchingCommands
+ */
+void freeListOfMatchingCommands(char **matches) {
+    for (int i = 0; matches[i] != NULL; i++)
+        free(matches[i]);
+    free(matches);
+}
@@ -0,0 +1,161 @@
+#include <unistd.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+
+#include "shellgibi.h"
+
+// for cat >file and <in >out without a cat process
+#define COPY_CHUNK (1L << 30)
+
+enum copy_method {COPY_RANGE, COPY_SENDFILE, COPY_SPLICE, COPY_READ_WRITE};
+
+/**
+ * Is it a command that only moves the bytes of files into a file?
+ * cat files >out, cat <in >>out, <in >out like zsh, or >out alone to empty it
+ */
+static bool is_pure_copy(struct command_t *command, int in_fd) {
+    if (command->next != NULL || command->background || command->auto_complete || command->heredoc > 0
+        || command->group != NULL || (command->redirects[1] == NULL && command->redirects[2] == NULL))
+        return false;
+    if (strcmp(command->name, "") == 0)
+        return command->arg_count == 0;
+    if (strcmp(command->name, "cat") != 0)
+        return false;
+    for (int i = 0; i < command->arg_count; i++)
+        if (command->args[i][0] == '-') // options and - for stdin are for the real cat
+            return false;
+    // cat reading the terminal stays a process of its own, so ^C stops it rather than us
+    return command->arg_count > 0 || command->redirects[0] != NULL || in_fd != STDIN_FILENO;
+}
+
+static ssize_t read_write(int in, int out) {
+    static char buf[131072];
+    ssize_t n = read(in, buf, sizeof(buf));
+    for (ssize_t done = 0, w; n > 0 && done < n; done += w)
+        if ((w = write(out, buf + done, n - done)) == -1) {
+            if (errno != EINTR)
+                return -1;
+            w = 0;
+        }
+    return n;
+}
+
+/**
+ * Copy the rest of in to out in the kernel: copy_file_range, which can reflink, then sendfile, or splice
+ * from a pipe, and a buffer as the last resort
+ * @return 0, -1 on an error with errno set
+ */
+static int kernel_copy(int in, int out) {
+    struct stat st;
+    enum copy_method how = fstat(in, &st) == 0 && S_ISFIFO(st.st_mode) ? COPY_SPLICE : COPY_RANGE;
+    bool copied = false;
+    while (1) {
+        ssize_t n;
+        if (how == COPY_RANGE)
+            n = copy_file_range(in, NULL, out, NULL, COPY_CHUNK, 0);
+        else if (how == COPY_SENDFILE)
+            n = sendfile(out, in, NULL, COPY_CHUNK);
+        else if (how == COPY_SPLICE)
+            n = splice(in, NULL, out, NULL, COPY_CHUNK, SPLICE_F_MOVE);
+        else
+            n = read_write(in, out);
+        if (n > 0) {
+            copied = true;
+            continue;
+        }
+        if (n == 0 && how == COPY_RANGE && !copied) { // some kernels copy nothing from /proc and the like
+            how = COPY_SENDFILE;
+            continue;
+        }
+        if (n == 0)
+            return 0;
+        if (errno == EINTR)
+            continue;
+        if (how != COPY_READ_WRITE && (errno == EXDEV || errno == EINVAL || errno == EOPNOTSUPP
+                                       || errno == ENOSYS || errno == ETXTBSY)) {
+            how = how == COPY_RANGE ? COPY_SENDFILE : COPY_READ_WRITE;
+            continue;
+        }
+        return -1;
+    }
+}
+
+static int copy_from(const char *name, int in, int out, struct stat *out_st) {
+    struct stat st;
+    if (fstat(in, &st) == 0 && S_ISREG(st.st_mode) && st.st_dev == out_st->st_dev && st.st_ino == out_st->st_ino
+        && st.st_size > 0) { // it would go on reading what it writes
+        printf("-%s: cat: %s: input file is output file\n", sysname, name);
+        return -1;
+    }
+    if (kernel_copy(in, out) == -1) {
+        printf("-%s: cat: %s: %s\n", sysname, name, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Do a pure copy command in the shell, without a process for cat
+ * @param  command [description]
+ * @param  in_fd   stdin of the command
+ * @return         false if it isn't one, for launch_command to run
+ */
+bool copy_command(struct command_t *command, int in_fd) {
+    if (!is_pure_copy(command, in_fd))
+        return false;
+    last_status = 0;
+
+    int in = in_fd;
+    if (command->redirects[0] != NULL && (in = open(command->redirects[0], O_RDONLY | O_CLOEXEC)) == -1) {
+        printf("-%s: %s: %s\n", sysname, command->redirects[0], strerror(errno));
+        last_status = 1;
+        return true;
+    }
+
+    // > truncates, >> goes on at the end: copy_file_range and sendfile refuse O_APPEND, so it seeks there
+    int out = -1;
+    if (command->redirects[1] != NULL)
+        out = open(command->redirects[1], O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (command->redirects[2] != NULL) { // >> wins over >, like in launch_command
+        if (out != -1)
+            close(out);
+        out = open(command->redirects[2], O_WRONLY | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    }
+    struct stat out_st;
+    if (out != -1 && fstat(out, &out_st) == -1) {
+        close(out);
+        out = -1;
+    }
+    if (out == -1) {
+        printf("-%s: %s: %s\n", sysname, command->redirects[2] ? command->redirects[2] : command->redirects[1],
+               strerror(errno));
+        last_status = 1;
+    } else if (command->redirects[2] != NULL)
+        lseek(out, 0, SEEK_END);
+
+    if (out != -1 && command->arg_count == 0 && (command->redirects[0] != NULL || strcmp(command->name, "cat") == 0)
+        && copy_from(command->redirects[0] ? command->redirects[0] : "-", in, out, &out_st) == -1)
+        last_status = 1;
+    for (int i = 0; out != -1 && i < command->arg_count; i++) { // like cat, a file that fails doesn't stop the rest
+        int fd = open(command->args[i], O_RDONLY | O_CLOEXEC);
+        if (fd == -1) {
+            printf("-%s: cat: %s: %s\n", sysname, command->args[i], strerror(errno));
+            last_status = 1;
+            continue;
+        }
+        if (copy_from(command->args[i], fd, out, &out_st) == -1)
+            last_status = 1;
+        close(fd);
+    }
+
+    if (out != -1)
+        close(out);
+    if (in != in_fd)
+        close(in);
+    return true;
+}
@@ -0,0 +1,270 @@
+#include <unistd.h>
+#include <sys/timerfd.h>
+#include <sys/signalfd.h>
+#include <sys/syscall.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <time.h>
+
+#include "shellgibi.h"
+
+// for every
+#define EVERY_USAGE "usage: every [-s] [-n runs] interval[ms|s|m|h] cmd args...\n"
+
+struct every_run {
+    char *path;                 // resolved once
+    char **argv;                // built once
+    int in_fd, out_fd;          // stdin and > or >> or the pipe to the next stage for every run, -1 if inherited
+    sigset_t old_mask;
+};
+
+struct every_stats {
+    long runs, skipped, late;
+    long on_time;               // runs started by their tick, the ones the delay stats are about
+    double delay_min, delay_max, delay_mean, delay_m2; // behind the deadline, Welford's running variance
+    double run_min, run_max, run_total;
+};
+
+static struct timespec ns_timespec(int64_t ns) {
+    struct timespec ts = {ns / 1000000000LL, ns % 1000000000LL};
+    return ts;
+}
+
+/** 1, 0.5, 250ms, 2s, 5m, 1h */
+static double parse_interval(const char *s) {
+    char *end;
+    double v = strtod(s, &end);
+    if (end == s || v <= 0) return -1;
+    if (*end == 0 || strcmp(end, "s") == 0) return v;
+    if (strcmp(end, "ms") == 0) return v / 1000;
+    if (strcmp(end, "m") == 0) return v * 60;
+    if (strcmp(end, "h") == 0) return v * 3600;
+    return -1;
+}
+
+static pid_t every_launch(struct every_run *r) {
+    if (r->in_fd != -1)
+        lseek(r->in_fd, 0, SEEK_SET); // every run reads its input from the start
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        sigprocmask(SIG_SETMASK, &r->old_mask, NULL);
+        if (r->out_fd != -1)
+            dup2(r->out_fd, STDOUT_FILENO);
+        if (r->in_fd != -1)
+            dup2(r->in_fd, STDIN_FILENO);
+        execv(r->path, r->argv);
+        exec_failed(r->argv[0]);
+    }
+    if (pid > 0) {
+        struct command_t job = {0};
+        job.name = r->argv[0];
+        job_started(pid, &job);
+    }
+    return pid;
+}
+
+static void every_print(struct every_stats *s, const char *interval) {
+    printf("every %s: %ld runs, %ld ticks skipped, %ld started late\n", interval, s->runs, s->skipped, s->late);
+    if (s->on_time > 0)
+        printf("start delay  min %.3fms  avg %.3fms  max %.3fms  jitter %.3fms\n", s->delay_min * 1e3,
+               s->delay_mean * 1e3, s->delay_max * 1e3,
+               s->on_time > 1 ? sqrt(s->delay_m2 / (s->on_time - 1)) * 1e3 : 0);
+    if (s->runs > 0)
+        printf("run time     min %.3fms  avg %.3fms  max %.3fms\n", s->run_min * 1e3,
+               s->run_total / s->runs * 1e3, s->run_max * 1e3);
+}
+
+static void record_delay(struct every_stats *s, double delay) {
+    if (s->on_time == 0 || delay < s->delay_min) s->delay_min = delay;
+    if (s->on_time == 0 || delay > s->delay_max) s->delay_max = delay;
+    s->on_time++;
+    double d = delay - s->delay_mean;
+    s->delay_mean += d / s->on_time;
+    s->delay_m2 += d * (delay - s->delay_mean);
+}
+
+static void record_run(struct every_stats *s, double seconds) {
+    if (s->runs == 0 || seconds < s->run_min) s->run_min = seconds;
+    if (s->runs == 0 || seconds > s->run_max) s->run_max = seconds;
+    s->runs++;
+    s->run_total += seconds;
+}
+
+/**
+ * every [-s] [-n runs] interval cmd args...: run cmd at a fixed rate until ^C or n runs. Ticks are absolute
+ * deadlines from the start, so a slow run doesn't shift the ones after it. A tick that comes while the
+ * previous run is still going starts the next run as soon as it ends, or is skipped with -s.
+ */
+int every(struct command_t *command, int in_fd) {
+    bool skip = false;
+    long max_runs = 0;
+    int first = 0;
+    while (first < command->arg_count && command->args[first][0] == '-') {
+        if (strcmp(command->args[first], "-s") == 0) {
+            skip = true;
+            first++;
+        } else if (strcmp(command->args[first], "-n") == 0 && first + 1 < command->arg_count) {
+            max_runs = atol(command->args[first + 1]);
+            first += 2;
+        } else {
+            printf(EVERY_USAGE);
+            return SUCCESS;
+        }
+    }
+    double interval = first < command->arg_count ? parse_interval(command->args[first]) : -1;
+    if (first + 1 >= command->arg_count || interval <= 0) {
+        printf(EVERY_USAGE);
+        return SUCCESS;
+    }
+    int64_t interval_ns = llround(interval * 1e9);
+    if (interval_ns == 0) interval_ns = 1;
+
+    // parsed and resolved once, each tick is just a fork and execv
+    struct every_run r;
+    char *name = command->args[first + 1];
+    r.path = resolve_command(name);
+    if (r.path == NULL) {
+        command_not_found(name);
+        last_status = 127;
+        return UNKNOWN;
+    }
+    int argc = command->arg_count - first - 1;
+    r.argv = malloc(sizeof(char *) * (argc + 1));
+    memcpy(r.argv, command->args + first + 1, sizeof(char *) * argc);
+    r.argv[argc] = NULL;
+
+    r.out_fd = -1;
+    if (command->redirects[1] != NULL)
+        r.out_fd = open(command->redirects[1], O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    else if (command->redirects[2] != NULL)
+        r.out_fd = open(command->redirects[2], O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    r.in_fd = -1;
+    if (command->heredoc > 0)
+        r.in_fd = command->heredoc;
+    else if (command->redirects[0] != NULL && (r.in_fd = open(command->redirects[0], O_RDONLY | O_CLOEXEC)) == -1) {
+        printf("-%s: %s: %s\n", sysname, command->redirects[0], strerror(errno));
+        last_status = 1; // like launch_command, rather than every run reading the terminal
+        if (r.out_fd != -1)
+            close(r.out_fd);
+        free(r.argv);
+        free(r.path);
+        return SUCCESS;
+    } else if (command->redirects[0] == NULL && in_fd != STDIN_FILENO)
+        r.in_fd = in_fd;
+
+    // the rest of the pipeline reads what the runs print, unless > sends that to a file
+    int pipe_fd = -1;
+    pid_t next_pid = -1;
+    if (command->next != NULL && (next_pid = launch_next(command->next, &pipe_fd)) != -1) {
+        if (r.out_fd == -1 && command->redirects[1] == NULL && command->redirects[2] == NULL)
+            r.out_fd = pipe_fd;
+        else
+            close(pipe_fd);
+    }
+
+    // ^C ends the loop rather than the shell, the running command gets it too
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigprocmask(SIG_BLOCK, &mask, &r.old_mask);
+    int sfd = signalfd(-1, &mask, SFD_CLOEXEC | SFD_NONBLOCK);
+    int tfd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+
+    int64_t start = monotonic_ns(), run_start = start;
+    struct itimerspec its;
+    its.it_interval = ns_timespec(interval_ns);
+    its.it_value = ns_timespec(start + interval_ns);
+    timerfd_settime(tfd, TFD_TIMER_ABSTIME, &its, NULL);
+
+    struct every_stats stats = {0};
+    uint64_t tick = 0; // deadlines passed, run k is due at start + k * interval
+    bool pending = false;
+    pid_t pid = every_launch(&r);
+    int pidfd = pid > 0 ? syscall(SYS_pidfd_open, pid, 0) : -1;
+    if (pid > 0)
+        record_delay(&stats, (monotonic_ns() - start) / 1e9);
+
+    while (tfd != -1 && sfd != -1) {
+        struct pollfd fds[3] = {{tfd, POLLIN, 0}, {sfd, POLLIN, 0}, {pidfd, POLLIN, 0}};
+        if (poll(fds, pidfd == -1 ? 2 : 3, -1) == -1 && errno != EINTR)
+            break;
+
+        if (fds[1].revents & POLLIN)
+            break;
+
+        if (pidfd != -1 && (fds[2].revents & POLLIN)) {
+            last_status = exit_status(wait_job(pid));
+            record_run(&stats, (monotonic_ns() - run_start) / 1e9);
+            close(pidfd);
+            pidfd = -1;
+            pid = -1;
+            if (max_runs > 0 && stats.runs >= max_runs)
+                break;
+            if (pending) { // its tick came while the last one was running
+                pending = false;
+                stats.late++;
+                run_start = monotonic_ns();
+                if ((pid = every_launch(&r)) > 0)
+                    pidfd = syscall(SYS_pidfd_open, pid, 0);
+            }
+        }
+
+        uint64_t expirations;
+        if (!(fds[0].revents & POLLIN) || read(tfd, &expirations, sizeof(expirations)) != sizeof(expirations))
+            continue;
+        tick += expirations;
+        if (pid > 0) {
+            if (skip || pending)
+                stats.skipped += expirations;
+            else {
+                pending = true;
+                stats.skipped += expirations - 1;
+            }
+            continue;
+        }
+        stats.skipped += expirations - 1; // we fell behind ourselves, only the latest tick counts
+        run_start = monotonic_ns();
+        if ((pid = every_launch(&r)) > 0) {
+            pidfd = syscall(SYS_pidfd_open, pid, 0);
+            record_delay(&stats, (run_start - start - (int64_t) tick * interval_ns) / 1e9);
+        }
+    }
+
+    if (pid > 0) { // interrupted, let the last run finish or die of the same ^C
+        last_status = exit_status(wait_job(pid));
+        record_run(&stats, (monotonic_ns() - run_start) / 1e9);
+    }
+    if (pidfd != -1)
+        close(pidfd);
+    struct signalfd_siginfo si;
+    while (sfd != -1 && read(sfd, &si, sizeof(si)) == sizeof(si)); // don't let a ^C through once unblocked
+    sigprocmask(SIG_SETMASK, &r.old_mask, NULL);
+    if (sfd != -1)
+        close(sfd);
+    if (tfd != -1)
+        close(tfd);
+    if (next_pid > 0) { // the next stage sees the end of its input, and its output comes before the summary
+        close(r.out_fd);
+        r.out_fd = -1;
+        last_status = exit_status(wait_job(next_pid));
+    }
+
+    printf("\n");
+    every_print(&stats, command->args[first]);
+
+    if (r.out_fd != -1)
+        close(r.out_fd);
+    if (r.in_fd != -1 && r.in_fd != command->heredoc && r.in_fd != in_fd)
+        close(r.in_fd);
+    free(r.argv);
+    free(r.path);
+    return SUCCESS;
+}
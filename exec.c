@@ -0,0 +1,569 @@
+#include <unistd.h>
+#include <sys/wait.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+
+#include "shellgibi.h"
+
+const char *sysname = "shellgibi";
+int last_status; // exit status of the last foreground command, like $? in bash
+
+static void redirect(int oldfd, int newfd);
+
+/** in a child whose execv failed: say why and exit like bash, 127 if there is no such file, 126 otherwise */
+void exec_failed(const char *name) {
+    fprintf(stderr, "-%s: %s: %s\n", sysname, name, strerror(errno));
+    exit(errno == ENOENT ? 127 : 126);
+}
+
+/** turn a wait status into a shell exit status */
+int exit_status(int status) {
+    if (WIFSIGNALED(status))
+        return 128 + WTERMSIG(status);
+    return WEXITSTATUS(status);
+}
+
+/**
+ * Run a parsed line: its pipelines and groups in order, skipping the ones && and || rule out
+ * @param  command first command of the list
+ * @return         EXIT if a command asked to exit, SYNTAX_ERROR if an entry didn't parse, otherwise the code
+ *                 of the last one run
+ */
+int run_list(struct command_t *command) {
+    int code = SUCCESS;
+    for (struct command_t *c = command; c != NULL; c = c->then) {
+        if (c->group && c->background) {
+            fflush(stdout);
+            pid_t pid = fork();
+            if (pid == 0) {
+                run_list(c->group);
+                exit(last_status);
+            }
+            if (pid > 0)
+                job_started(pid, c);
+            last_status = 0;
+            code = SUCCESS;
+        } else if (c->group)
+            code = run_list(c->group);
+        else if (parse_entry(c) == -1) {
+            last_status = 2; // like bash, and nothing after it runs
+            return SYNTAX_ERROR;
+        } else
+            code = process_command2(c, STDIN_FILENO);
+        if (code == EXIT || code == SYNTAX_ERROR)
+            return code;
+
+        // a skipped command leaves the status as it was, so `a && b || c' runs c when a fails
+        while (c->then && ((c->op == LIST_AND && last_status != 0) || (c->op == LIST_OR && last_status == 0))) {
+            c = c->then;
+            skip_entry(c);
+        }
+    }
+    return code;
+}
+
+int process_command2(struct command_t *command, int in_fd) {
+    last_status = 0;
+    if (strcmp(command->name, "") == 0) {
+        copy_command(command, in_fd); // <in >out or >out
+        return SUCCESS;
+    }
+
+    if (strcmp(command->name, "exit") == 0)
+        return EXIT;
+
+    if (strcmp(command->name, "cd") == 0) {
+        char *dir = command->arg_count > 0 ? command->args[0] : getenv("HOME");
+        bool back = dir != NULL && strcmp(dir, "-") == 0;
+        if (back)
+            dir = getenv("OLDPWD");
+        if (dir == NULL) {
+            printf("-%s: %s: %s not set\n", sysname, command->name, back ? "OLDPWD" : "HOME");
+            last_status = 1;
+            return SUCCESS;
+        }
+        dir = strdup(dir); // change_directory replaces OLDPWD
+        if (change_directory(dir) == -1) {
+            printf("-%s: %s: %s: %s\n", sysname, command->name, dir, strerror(errno));
+            last_status = 1;
+        } else if (back)
+            printf("%s\n", getenv("PWD"));
+        free(dir);
+        return SUCCESS;
+    }
+
+    if (strcmp(command->name, "j") == 0)
+        return jump(command);
+
+    // user defined commands
+    if (strcmp(command->name, "alarm") == 0) {
+        if (command->arg_count != 2) {
+            printf("Not in the right format. Should be like the following: alarm time(hour.minute) soundFile\n");
+            return SUCCESS;
+        }
+
+        char *time_arr[2];
+        int c = 0;
+        char s[strlen(command->args[0]) + 1];
+        strcpy(s, command->args[0]);
+        char *token = strtok(s, ".");
+        while (token && c < 2) {
+            time_arr[c] = token;
+            c++;
+            token = strtok(NULL, ".");
+        }
+
+        // get pwd
+        char pwd[1024];
+        getcwd(pwd, sizeof(pwd));
+
+        pid_t pid = fork();
+        if (pid == 0) // child
+        {
+            char str2[2048];
+            snprintf(str2, sizeof(str2), "* * * aplay %s/%s", pwd, command->args[1]);
+
+
+            char *echo_args[] = {"/bin/echo", time_arr[1], time_arr[0], str2, NULL};
+
+            int fd = open("mycron", O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+            dup2(fd, 1);
+            close(fd);
+
+            execv(echo_args[0], echo_args);
+            exit(0);
+        }
+
+        waitpid(pid, NULL, 0); // not wait(), that could reap a background job
+        pid_t pid1 = fork();
+        if (pid1 == 0) {
+
+            char *cron_args[] = {"/usr/bin/crontab", "mycron", NULL};
+            execv(cron_args[0], cron_args);
+
+            exit(0);
+        }
+        waitpid(pid1, NULL, 0);
+        pid_t pid2 = fork();
+        if (pid2 == 0) {
+
+            char *rm_args[] = {"/bin/rm", "mycron", NULL};
+            execv(rm_args[0], rm_args);
+
+            exit(0);
+        }
+
+        waitpid(pid2, NULL, 0);
+        printf("alarm set.\n");
+        return SUCCESS;
+    }
+
+    if (strcmp(command->name, "todo") == 0) {
+        printf("in todo\n");
+        //print_command(command);
+
+        if (command->arg_count == 0) {
+            printf("add to add a todo, see to see the todo list and del to remove from list\n");
+            return SUCCESS;
+        }
+        if (strcmp(command->args[0], "delete") == 0) {
+            deleteLineFromFile(".todo", command->args[1]);
+            printf("deleted todo successfully\n");
+            return SUCCESS;
+        }
+
+
+        if (strcmp(command->args[0], "see") == 0) {
+            FILE *fptr1;
+            char ch;
+            fptr1 = fopen(".todo", "ab+");
+            ch = fgetc(fptr1);
+            while (ch != EOF) {
+                printf("%c", ch);
+                ch = fgetc(fptr1);
+            }
+            fclose(fptr1);
+            return SUCCESS;
+        }
+        if (strcmp(command->args[0], "add") == 0) {
+
+            int x = getCurrentLineNumber(".todo");
+
+
+            int new_x = x + 1;
+
+
+            pid_t pid1;
+            pid1 = fork();
+            if (pid1 == 0) {
+
+                int fd = open(".todo", O_RDWR | O_CREAT | O_APPEND, S_IRUSR | S_IWUSR);
+                dup2(fd, 1);
+                close(fd);
+
+                char *line = numberedLine(new_x, command->args + 1, command->arg_count - 1);
+                char *echo_args[] = {"/bin/echo", line, NULL};
+
+                execv(echo_args[0], echo_args);
+                free(line);
+                exit(0);
+            }
+            waitpid(pid1, NULL, 0);
+            return SUCCESS;
+        }
+
+        return SUCCESS;
+    }
+
+    // job management
+    if (strcmp(command->name, "myjobs") == 0) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            char *args[6];
+            args[0] = "/bin/ps";        // first arg is the full path to the executable
+            args[1] = "-U";
+            args[2] = USER;
+            args[3] = "-eo";
+            args[4] = "pid,cmd,stat";
+            args[5] = NULL;
+            //printf("im here\n");
+            execv(args[0], args);
+            exit(0);
+        } else {
+            waitpid(pid, NULL, 0);
+            //printf("yay, look at me\n");
+            return SUCCESS;
+        }
+    }
+
+    if (strcmp(command->name, "pause") == 0) {
+        // check if args match etc
+
+        pid_t pid = fork();
+        if (pid == 0) {
+            char *args[4];
+            args[0] = "/bin/kill";        // first arg is the full path to the executable
+            args[1] = "-TSTP";
+            args[2] = command->args[0];
+            args[3] = NULL;
+            execv(args[0], args);
+            exit(0);
+        } else {
+            waitpid(pid, NULL, 0);
+            return SUCCESS;
+        }
+    }
+
+    if (strcmp(command->name, "mybg") == 0) {
+        // check if args match etc
+
+        pid_t pid = fork();
+        if (pid == 0) {
+            char *args[4];
+            args[0] = "/bin/kill";        // first arg is the full path to the executable
+            args[1] = "-CONT";
+            args[2] = command->args[0];
+            args[3] = NULL;
+            printf("running cont\n");
+            execv(args[0], args);
+            printf("just ran cont\n");
+            exit(0);
+        } else {
+            printf("parent\n");
+            waitpid(pid, NULL, 0);
+            printf("child done\n");
+
+            return SUCCESS;
+        }
+    }
+    if (strcmp(command->name, "myfg") == 0) {
+        // check if args match etc
+
+        pid_t pid = fork();
+        if (pid == 0) {
+            char *args[4];
+            args[0] = "/bin/kill";        // first arg is the full path to the executable
+            args[1] = "-CONT";
+            args[2] = command->args[0];
+            args[3] = NULL;
+            execv(args[0], args);
+            exit(0);
+        } else {
+            int a = atoi(command->args[0]);
+            waitpid(pid, NULL, 0);
+            //printf("waiting for pid to finish\n");
+            wait_job(a);
+            //printf("wait over\n");
+
+            return SUCCESS;
+        }
+    }
+
+    if (strcmp(command->name, "motivate") == 0) {
+        //printf("in motivate\n");
+        //print_command(command);
+
+        if (command->arg_count == 0) {
+            printRandomline(".motivate");
+            return SUCCESS;
+        }
+        else if (strcmp(command->args[0], "delete") == 0) {
+            deleteLineFromFile(".motivate", command->args[1]);
+            printf("deleted from motivate successfully\n");
+            return SUCCESS;
+        }
+
+
+        else if (strcmp(command->args[0], "add") == 0) {
+
+            int x = getCurrentLineNumber(".motivate");
+
+            int new_x = x + 1;
+
+            pid_t pid1;
+            pid1 = fork();
+            if (pid1 == 0) {
+
+                int fd = open(".motivate", O_RDWR | O_CREAT | O_APPEND, S_IRUSR | S_IWUSR);
+                dup2(fd, 1);
+                close(fd);
+
+                char *line = numberedLine(new_x, command->args + 1, command->arg_count - 1);
+                char *echo_args[] = {"/bin/echo", line, NULL};
+
+                execv(echo_args[0], echo_args);
+                free(line);
+                exit(0);
+            }
+            waitpid(pid1, NULL, 0);
+            return SUCCESS;
+        }
+    }
+
+    if (strcmp(command->name, "jobstats") == 0) {
+        jobstats(command);
+        return SUCCESS;
+    }
+
+    if (strcmp(command->name, "profile") == 0)
+        return profile(command, in_fd);
+
+    if (strcmp(command->name, "xargs") == 0)
+        return xargs(command, in_fd);
+
+    if (strcmp(command->name, "every") == 0)
+        return every(command, in_fd);
+
+    if (strcmp(command->name, "meter") == 0)
+        return meter(command, in_fd);
+
+    if (strcmp(command->name, "limit") == 0)
+        return limit(command, in_fd);
+
+    if (copy_command(command, in_fd))
+        return SUCCESS; // cat files >out, moved by the kernel without a cat process
+
+    pid_t pid = launch_command(command, in_fd);
+    if (pid == -1)
+        return UNKNOWN;
+    if (!command->background)
+        last_status = exit_status(wait_job(pid)); // wait for child process to finish
+    /*if (command->auto_complete) {
+        printf("\nauto\n");
+    }*/
+    return SUCCESS;
+}
+
+/**
+ * For a builtin with more of the pipeline after it: fork the rest of the pipeline reading a new pipe,
+ * the way launch_command chains its stages
+ * @param  next   the stage after the builtin
+ * @param  out_fd set to the write end of the pipe, close-on-exec, for the builtin to send its output to
+ * @return        pid of the rest of the pipeline, -1 if it couldn't be started
+ */
+pid_t launch_next(struct command_t *next, int *out_fd) {
+    int fd[2];
+    if (pipe2(fd, O_CLOEXEC) == -1)
+        return -1;
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fd[1]); // or it never sees the end of its input
+        fcntl(fd[0], F_SETFD, 0); // it may already be fd 0, which redirect() leaves as it is
+        process_command2(next, fd[0]);
+        exit(last_status); // a pipeline's status is its last command's
+    }
+    close(fd[0]);
+    if (pid == -1) {
+        close(fd[1]);
+        return -1;
+    }
+    job_started(pid, next);
+    *out_fd = fd[1];
+    return pid;
+}
+
+/**
+ * Fork a child that runs an external command, with its redirects and pipes
+ * @param  command [description]
+ * @param  in_fd   stdin of the command
+ * @return         pid of the child, -1 if the command was not found
+ */
+pid_t launch_command(struct command_t *command, int in_fd) {
+    // resolve here rather than in the child, so a missing command is an error we can report
+    char *path = NULL;
+    if (!command->auto_complete) {
+        path = resolve_command(command->name);
+        if (path == NULL) {
+            command_not_found(command->name);
+            last_status = 127;
+            return -1;
+        }
+    }
+
+    fflush(stdout); // or pipeline children that exit() would write our buffered output again
+    pid_t pid = fork();
+    if (pid == 0) // child
+    {
+        limit_child(); // if it runs under limit
+
+        /// This shows how to do exec with environ (but is not available on MacOs)
+        // extern char** environ; // environment variables
+        // execvpe(command->name, command->args, environ); // exec+args+path+environ
+
+        /// This shows how to do exec with auto-path resolve
+        // add a NULL argument to the end of args, and the name to the beginning
+        // as required by exec
+
+        if (command->auto_complete) {
+            // the last character is ?, we don't want that
+
+            char *cmdName = malloc(strlen(command->name));
+            for (int i = 0; i < strlen(command->name) - 1; i++) {
+                cmdName[i] = command->name[i];
+                //printf("autocomplete, %s\n", cmdName);
+            }
+            cmdName[strlen(command->name) - 1] = 0;
+            char **matches = getListOfMatchingCommands(cmdName);
+            if (matches[0] == NULL) {
+                printf("\nNo matches!\n");
+            } else {
+                for (int i = 0; i < MAX_MATCHES_AUTOCOMPLETE; i++) { // command fully typed
+                    if (matches[i] == NULL)
+                        break;
+                    if (strcmp(matches[i], cmdName) == 0) {
+                        printf("\n");
+                        char *args[2];
+
+                        args[0] = "/bin/ls";        // first arg is the full path to the executable
+                        args[1] = NULL;
+                        execv(args[0], args);
+                        freeListOfMatchingCommands(matches);
+                        free(cmdName);
+                        exit(0);
+                    }
+                }
+                printf("\nmatching commands\n"); // print matching commands
+                for (int i = 0; matches[i] != NULL; i++)
+                    printf("%s\n", matches[i]);
+                freeListOfMatchingCommands(matches);
+                free(cmdName);
+                exit(0);
+            }
+            freeListOfMatchingCommands(matches);
+            free(cmdName);
+            exit(1); // nothing to complete to, and nothing to run
+        }
+
+        // increase args size by 2
+        command->args = (char **) realloc(
+                command->args, sizeof(char *) * (command->arg_count += 2));
+
+        // shift everything forward by 1
+        for (int i = command->arg_count - 2; i > 0; --i)
+            command->args[i] = command->args[i - 1];
+
+
+        setArgsForExecv(command, path);
+
+        //execvp(command->name, command->args); // exec+args+path
+        if (command->redirects[0] != NULL) {
+            int fd = open(command->redirects[0], O_RDONLY);
+            if (fd == -1) {
+                printf("-%s: %s: %s\n", sysname, command->redirects[0], strerror(errno));
+                exit(1);
+            }
+
+            dup2(fd, 0);
+
+            close(fd);     // fd no longer needed - the dup'ed handles are sufficient
+        }
+
+        if (command->heredoc > 0)
+            dup2(command->heredoc, 0); // the memfd itself is close-on-exec
+
+        if (command->redirects[1] != NULL) {
+            int fd = open(command->redirects[1], O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+
+            dup2(fd, 1);   // make stdout go to file
+
+            close(fd);     // fd no longer needed - the dup'ed handles are sufficient
+        }
+
+        if (command->redirects[2] != NULL) {
+            int fd = open(command->redirects[2], O_RDWR | O_CREAT | O_APPEND, S_IRUSR | S_IWUSR);
+
+            dup2(fd, 1);   // make stdout go to file
+
+            close(fd);     // fd no longer needed - the dup'ed handles are sufficient
+        }
+
+
+        if (command->next != NULL) {  // Piping
+            // pipe stuff
+            int fd[2];
+            pipe(fd);
+            int pid = fork();
+            if (pid == 0) { //
+                close(fd[0]); /* unused */
+                redirect(in_fd, STDIN_FILENO);  /* read from in_fd */
+                redirect(fd[1], STDOUT_FILENO); /* write to fd[1] */
+
+                execv(command->args[0], command->args);
+                exec_failed(command->name);
+                //close(pfd[1]);
+
+            } else {
+                close(fd[1]); /* unused */
+                close(in_fd); /* unused */
+                // start the next stage before waiting, or a full pipe blocks this one forever
+                process_command2(command->next, fd[0]);
+                waitpid(pid, NULL, 0);
+                exit(last_status); // a pipeline's status is its last command's
+            }
+        } else {
+            redirect(in_fd, STDIN_FILENO);
+            execv(command->args[0], command->args);
+            exec_failed(command->name);
+        }
+
+        exit(0);
+
+        /// TODO: do your own exec with path resolving using execv()
+    }
+    free(path);
+    if (pid > 0)
+        job_started(pid, command);
+    return pid;
+}
+
+
+/** move oldfd to newfd */
+static void redirect(int oldfd, int newfd) {
+    if (oldfd != newfd)
+        if (dup2(oldfd, newfd) != -1)
+            close(oldfd); /* successfully redirected */
+}
@@ -0,0 +1,524 @@
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#include "shellgibi.h"
+
+// for globbing
+#define GLOB_DIRENT_BUF (64 * 1024)     // getdents64 buffer, many entries per syscall
+#define GLOB_MAX_THREADS 8
+#define GLOB_SPAWN_QUEUE 16             // directories waiting before more threads are worth starting
+
+struct linux_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+enum glob_op_type {
+    GLOB_LITERAL,
+    GLOB_ANY,       // ?
+    GLOB_STAR,      // *
+    GLOB_CLASS,     // [...]
+};
+
+struct glob_op {
+    enum glob_op_type type;
+    int len;                // of the literal
+    char *literal;
+    uint64_t set[4];        // bytes the class matches
+};
+
+// one /-separated part of a pattern, compiled
+struct glob_component {
+    char *text;             // unescaped, for literal components
+    bool literal;           // no wildcards, looked up without reading the directory
+    bool recursive;         // **, any number of directories
+    bool dot_ok;            // written with a leading ., so it may match hidden names
+    struct glob_op *ops;
+    int op_count;
+    const char *suffix;     // literal the name has to end with, checked before anything else
+    int suffix_len;
+};
+
+struct glob_pattern {
+    char *root;             // the leading literal directories, "" for the current one
+    struct glob_component *comps;
+    int count;
+    bool dirs_only;         // the pattern ended with /
+};
+
+struct glob_task {
+    char *path;
+    int comp;               // next component to match in it
+    struct glob_task *next;
+};
+
+struct glob_results {
+    char **paths;
+    size_t count, cap;
+};
+
+struct glob_state {
+    struct glob_pattern *pat;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    struct glob_task *queue;
+    int queued, busy;       // tasks waiting and being worked on
+    bool spawned;
+    int thread_count;
+    pthread_t threads[GLOB_MAX_THREADS];
+    struct glob_results results[GLOB_MAX_THREADS + 1]; // one per thread, the caller's is last
+};
+
+struct glob_worker {
+    struct glob_state *state;
+    struct glob_results *results;
+};
+
+/**
+ * Does an argument have wildcards that are not escaped?
+ */
+bool has_glob(const char *arg) {
+    for (const char *p = arg; *p; p++) {
+        if (*p == '\\' && p[1])
+            p++;
+        else if (*p == '*' || *p == '?' || *p == '[')
+            return true;
+    }
+    return false;
+}
+
+static struct glob_op *add_op(struct glob_component *c, enum glob_op_type type) {
+    c->ops = realloc(c->ops, sizeof(struct glob_op) * (c->op_count + 1));
+    struct glob_op *op = &c->ops[c->op_count++];
+    memset(op, 0, sizeof(struct glob_op));
+    op->type = type;
+    return op;
+}
+
+static void add_literal(struct glob_component *c, char ch) {
+    struct glob_op *op = c->op_count > 0 ? &c->ops[c->op_count - 1] : NULL;
+    if (op == NULL || op->type != GLOB_LITERAL) {
+        op = add_op(c, GLOB_LITERAL);
+        op->literal = malloc(strlen(c->text) + 1); // can't be longer than the component
+    }
+    op->literal[op->len++] = ch;
+    op->literal[op->len] = 0;
+}
+
+/**
+ * Parse a [...] class starting at s
+ * @return  past its ], or NULL if it isn't closed and the [ is a literal
+ */
+static const char *compile_class(struct glob_component *c, const char *s) {
+    const char *p = s + 1;
+    bool negate = *p == '!' || *p == '^';
+    if (negate) p++;
+    const char *end = p + (*p == ']'); // a ] first is a member
+    while (*end && *end != ']') end++;
+    if (*end == 0)
+        return NULL;
+
+    struct glob_op *op = add_op(c, GLOB_CLASS);
+    for (const char *q = p; q < end; q++) {
+        unsigned char lo = *q, hi = *q;
+        if (q + 2 < end && q[1] == '-') {
+            hi = q[2];
+            q += 2;
+        }
+        for (int ch = lo; ch <= hi; ch++)
+            op->set[ch >> 6] |= 1ULL << (ch & 63);
+    }
+    if (negate)
+        for (int i = 0; i < 4; i++)
+            op->set[i] = ~op->set[i];
+    op->set[0] &= ~1ULL; // never the terminating NUL
+    return end + 1;
+}
+
+static void compile_component(struct glob_component *c, const char *s) {
+    memset(c, 0, sizeof(struct glob_component));
+    c->text = strdup(s);
+    c->recursive = strcmp(s, "**") == 0;
+    c->dot_ok = s[0] == '.';
+    const char *class_end;
+    for (const char *p = s; *p;) {
+        if (*p == '*') {
+            if (c->op_count == 0 || c->ops[c->op_count - 1].type != GLOB_STAR)
+                add_op(c, GLOB_STAR);
+            p++;
+        } else if (*p == '?') {
+            add_op(c, GLOB_ANY);
+            p++;
+        } else if (*p == '[' && (class_end = compile_class(c, p)) != NULL) {
+            p = class_end;
+        } else {
+            if (*p == '\\' && p[1])
+                p++;
+            add_literal(c, *p++);
+        }
+    }
+    c->literal = c->op_count == 1 && c->ops[0].type == GLOB_LITERAL;
+    if (c->literal)
+        strcpy(c->text, c->ops[0].literal);
+    if (c->op_count >= 2 && c->ops[c->op_count - 1].type == GLOB_LITERAL && c->ops[c->op_count - 2].type == GLOB_STAR) {
+        c->suffix = c->ops[c->op_count - 1].literal;
+        c->suffix_len = c->ops[c->op_count - 1].len;
+    }
+}
+
+static char *join_path(const char *dir, const char *name) {
+    size_t dl = strlen(dir), nl = strlen(name);
+    char *path = malloc(dl + nl + 2);
+    memcpy(path, dir, dl);
+    if (dl > 0 && dir[dl - 1] != '/')
+        path[dl++] = '/';
+    memcpy(path + dl, name, nl + 1);
+    return path;
+}
+
+/**
+ * Compile a pattern once for every directory it will be matched in
+ * @return  [description]
+ */
+static struct glob_pattern *glob_compile(const char *pattern) {
+    struct glob_pattern *pat = calloc(1, sizeof(struct glob_pattern));
+    char *copy = strdup(pattern);
+    size_t len = strlen(copy);
+    pat->dirs_only = len > 1 && copy[len - 1] == '/';
+    pat->root = strdup(copy[0] == '/' ? "/" : "");
+
+    char *save;
+    for (char *part = strtok_r(copy, "/", &save); part; part = strtok_r(NULL, "/", &save)) {
+        pat->comps = realloc(pat->comps, sizeof(struct glob_component) * (pat->count + 1));
+        compile_component(&pat->comps[pat->count++], part);
+    }
+    // leading literal directories are where the walk starts, not something to look for
+    int skip = 0;
+    while (skip < pat->count - 1 && pat->comps[skip].literal) {
+        char *root = join_path(pat->root, pat->comps[skip].text);
+        free(pat->root);
+        pat->root = root;
+        skip++;
+    }
+    for (int i = 0; i < skip; i++) {
+        free(pat->comps[i].text);
+        for (int j = 0; j < pat->comps[i].op_count; j++)
+            free(pat->comps[i].ops[j].literal);
+        free(pat->comps[i].ops);
+    }
+    memmove(pat->comps, pat->comps + skip, sizeof(struct glob_component) * (pat->count - skip));
+    pat->count -= skip;
+    free(copy);
+    return pat;
+}
+
+static void glob_free(struct glob_pattern *pat) {
+    for (int i = 0; i < pat->count; i++) {
+        for (int j = 0; j < pat->comps[i].op_count; j++)
+            free(pat->comps[i].ops[j].literal);
+        free(pat->comps[i].ops);
+        free(pat->comps[i].text);
+    }
+    free(pat->comps);
+    free(pat->root);
+    free(pat);
+}
+
+static bool match_ops(const struct glob_op *ops, int count, const char *s) {
+    int i = 0, star = -1;
+    const char *star_s = NULL;
+    while (1) {
+        if (i < count) {
+            const struct glob_op *op = &ops[i];
+            if (op->type == GLOB_STAR) {
+                star = i++;
+                star_s = s;
+                continue;
+            }
+            if (op->type == GLOB_LITERAL ? strncmp(s, op->literal, op->len) == 0
+                : op->type == GLOB_ANY ? *s != 0
+                : (op->set[(unsigned char) *s >> 6] >> (*s & 63)) & 1) {
+                s += op->type == GLOB_LITERAL ? op->len : 1;
+                i++;
+                continue;
+            }
+        } else if (*s == 0)
+            return true;
+        // no match here, let the last * take one more character
+        if (star == -1 || *star_s == 0)
+            return false;
+        s = ++star_s;
+        i = star + 1;
+    }
+}
+
+static bool match_component(const struct glob_component *c, const char *name, size_t len) {
+    if (name[0] == '.' && !c->dot_ok)
+        return false;
+    if (c->suffix && (len < (size_t) c->suffix_len || memcmp(name + len - c->suffix_len, c->suffix, c->suffix_len) != 0))
+        return false;
+    return match_ops(c->ops, c->op_count, name);
+}
+
+/** d_type says directory, or it is a link or an unknown type that turns out to be one */
+static bool is_dir(int dirfd, const char *name, unsigned char type, bool follow) {
+    if (type == DT_DIR)
+        return true;
+    if ((type != DT_LNK || !follow) && type != DT_UNKNOWN)
+        return false;
+    struct stat st;
+    return fstatat(dirfd, name, &st, follow ? 0 : AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(st.st_mode);
+}
+
+static void add_result(struct glob_results *r, char *path) {
+    if (r->count == r->cap) {
+        r->cap = r->cap ? r->cap * 2 : 64;
+        r->paths = realloc(r->paths, sizeof(char *) * r->cap);
+    }
+    r->paths[r->count++] = path;
+}
+
+/** emit a match, as a directory with a / if the pattern asked for directories */
+static void emit(struct glob_state *st, struct glob_results *r, int dirfd, const char *dir, const char *name,
+                 unsigned char type) {
+    if (!st->pat->dirs_only) {
+        add_result(r, join_path(dir, name));
+        return;
+    }
+    if (!is_dir(dirfd, name, type, true))
+        return;
+    char *path = join_path(dir, name);
+    size_t len = strlen(path);
+    path = realloc(path, len + 2);
+    strcpy(path + len, "/");
+    add_result(r, path);
+}
+
+static void push_tasks(struct glob_state *st, struct glob_task *list, int n);
+
+/**
+ * Match one component in one directory. Matches of the last component are results,
+ * directories matching an earlier one become new tasks.
+ */
+static void glob_dir(struct glob_state *st, struct glob_task *task, struct glob_results *r, char *buf) {
+    struct glob_pattern *pat = st->pat;
+    struct glob_component *c = &pat->comps[task->comp];
+    bool last = task->comp == pat->count - 1;
+    struct glob_task *found = NULL;
+    int found_count = 0;
+
+    if (c->literal) { // no need to read the directory for it
+        char *path = join_path(task->path, c->text);
+        struct stat sb;
+        if (!last) {
+            struct glob_task *t = malloc(sizeof(struct glob_task));
+            t->path = path;
+            t->comp = task->comp + 1;
+            t->next = NULL;
+            push_tasks(st, t, 1);
+        } else if (lstat(path, &sb) == 0 && (!pat->dirs_only || is_dir(AT_FDCWD, path, DT_UNKNOWN, true))) {
+            if (pat->dirs_only) {
+                path = realloc(path, strlen(path) + 2);
+                strcat(path, "/");
+            }
+            add_result(r, path);
+        } else
+            free(path);
+        return;
+    }
+
+    int fd = open(task->path[0] ? task->path : ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd == -1)
+        return;
+    // after **, entries are also matched against the component that follows it: ** can be no directories
+    struct glob_component *next = c->recursive && !last ? &pat->comps[task->comp + 1] : NULL;
+    bool next_last = task->comp + 1 == pat->count - 1;
+    long n;
+    while ((n = syscall(SYS_getdents64, fd, buf, GLOB_DIRENT_BUF)) > 0) {
+        for (long off = 0; off < n;) {
+            struct linux_dirent64 *de = (struct linux_dirent64 *) (buf + off);
+            off += de->d_reclen;
+            const char *name = de->d_name;
+            if (name[0] == '.' && (name[1] == 0 || (name[1] == '.' && name[2] == 0)))
+                continue;
+            size_t len = strlen(name);
+            int then = -1; // component to look for in the entry, if it is a directory to go into
+
+            if (c->recursive) {
+                if (name[0] == '.')
+                    continue; // ** doesn't go into or match hidden names
+                if (last)
+                    emit(st, r, fd, task->path, name, de->d_type);
+                else if (match_component(next, name, len)) {
+                    if (next_last)
+                        emit(st, r, fd, task->path, name, de->d_type);
+                    else
+                        then = task->comp + 2;
+                }
+                if (is_dir(fd, name, de->d_type, false)) { // symlinks aren't followed, they could loop
+                    struct glob_task *t = malloc(sizeof(struct glob_task));
+                    t->path = join_path(task->path, name);
+                    t->comp = task->comp;
+                    t->next = found;
+                    found = t;
+                    found_count++;
+                }
+            } else if (match_component(c, name, len)) {
+                if (last)
+                    emit(st, r, fd, task->path, name, de->d_type);
+                else
+                    then = task->comp + 1;
+            }
+
+            if (then != -1 && is_dir(fd, name, de->d_type, true)) {
+                struct glob_task *t = malloc(sizeof(struct glob_task));
+                t->path = join_path(task->path, name);
+                t->comp = then;
+                t->next = found;
+                found = t;
+                found_count++;
+            }
+        }
+    }
+    close(fd);
+    if (found)
+        push_tasks(st, found, found_count);
+}
+
+/** take tasks until there are none left and none being worked on that could add more */
+static void glob_work(struct glob_worker *w) {
+    struct glob_state *st = w->state;
+    char *buf = malloc(GLOB_DIRENT_BUF);
+    pthread_mutex_lock(&st->lock);
+    while (1) {
+        while (st->queue == NULL && st->busy > 0)
+            pthread_cond_wait(&st->cond, &st->lock);
+        if (st->queue == NULL)
+            break; // nothing queued and nobody left to queue more
+        struct glob_task *task = st->queue;
+        st->queue = task->next;
+        st->queued--;
+        st->busy++;
+        pthread_mutex_unlock(&st->lock);
+
+        glob_dir(st, task, w->results, buf);
+        free(task->path);
+        free(task);
+
+        pthread_mutex_lock(&st->lock);
+        if (--st->busy == 0 && st->queue == NULL)
+            pthread_cond_broadcast(&st->cond);
+    }
+    pthread_mutex_unlock(&st->lock);
+    free(buf);
+}
+
+static void *glob_thread(void *arg) {
+    glob_work(arg);
+    free(arg);
+    return NULL;
+}
+
+/**
+ * Queue directories to look in. Threads are only started once there is a backlog,
+ * so small patterns never pay for them.
+ */
+static void push_tasks(struct glob_state *st, struct glob_task *list, int n) {
+    struct glob_task *tail = list;
+    while (tail->next) tail = tail->next;
+    pthread_mutex_lock(&st->lock);
+    tail->next = st->queue;
+    st->queue = list;
+    st->queued += n;
+    if (!st->spawned && st->queued >= GLOB_SPAWN_QUEUE) {
+        st->spawned = true;
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        int want = cpus > GLOB_MAX_THREADS ? GLOB_MAX_THREADS : cpus - 1;
+        for (int i = 0; i < want; i++) {
+            struct glob_worker *w = malloc(sizeof(struct glob_worker));
+            w->state = st;
+            w->results = &st->results[st->thread_count];
+            if (pthread_create(&st->threads[st->thread_count], NULL, glob_thread, w) != 0) {
+                free(w);
+                break;
+            }
+            st->thread_count++;
+        }
+    }
+    if (n == 1)
+        pthread_cond_signal(&st->cond);
+    else
+        pthread_cond_broadcast(&st->cond);
+    pthread_mutex_unlock(&st->lock);
+}
+
+static int compare_paths(const void *a, const void *b) {
+    return strcmp(*(char **) a, *(char **) b);
+}
+
+/**
+ * Expand a glob pattern with * ? [...] and **
+ * @param  pattern [description]
+ * @param  count   set to the number of matches
+ * @return         sorted malloc'd array of malloc'd paths, NULL if nothing matched
+ */
+char **glob_expand(const char *pattern, int *count) {
+    struct glob_state st;
+    memset(&st, 0, sizeof(st));
+    st.pat = glob_compile(pattern);
+    pthread_mutex_init(&st.lock, NULL);
+    pthread_cond_init(&st.cond, NULL);
+    *count = 0;
+    if (st.pat->count == 0) {
+        glob_free(st.pat);
+        return NULL;
+    }
+
+    struct glob_task *root = malloc(sizeof(struct glob_task));
+    root->path = strdup(st.pat->root);
+    root->comp = 0;
+    root->next = NULL;
+    st.queue = root;
+    st.queued = 1;
+
+    // this thread works too, and is the only one unless the walk gets big
+    struct glob_worker self = {&st, &st.results[GLOB_MAX_THREADS]};
+    glob_work(&self);
+    for (int i = 0; i < st.thread_count; i++)
+        pthread_join(st.threads[i], NULL);
+
+    size_t total = 0;
+    for (int i = 0; i <= GLOB_MAX_THREADS; i++)
+        total += st.results[i].count;
+    char **paths = NULL;
+    if (total > 0) {
+        paths = malloc(sizeof(char *) * (total + 1));
+        size_t k = 0;
+        for (int i = 0; i <= GLOB_MAX_THREADS; i++) {
+            if (st.results[i].count == 0)
+                continue; // and its paths are NULL, which memcpy mustn't get even for no bytes
+            memcpy(paths + k, st.results[i].paths, sizeof(char *) * st.results[i].count);
+            k += st.results[i].count;
+        }
+        qsort(paths, total, sizeof(char *), compare_paths);
+        paths[total] = NULL;
+    }
+    for (int i = 0; i <= GLOB_MAX_THREADS; i++)
+        free(st.results[i].paths);
+    pthread_mutex_destroy(&st.lock);
+    pthread_cond_destroy(&st.cond);
+    glob_free(st.pat);
+    *count = total;
+    return paths;
+}
@@ -0,0 +1,243 @@
+#include <sys/wait.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#include "shellgibi.h"
+
+// for job accounting
+#define JOBSTATS_MAX 1024 // only the most recent jobs are kept, totals cover the whole session
+
+struct job_stat {
+    pid_t pid;
+    char *name;
+    bool background, done;
+    int status;
+    int64_t start;          // monotonic_ns
+    double wall, user, sys; // seconds
+    long maxrss;            // kilobytes
+    long minflt, majflt, nvcsw, nivcsw;
+    bool limited;           // run by limit
+    char *cgroup;           // its own cgroup until it is reaped, NULL if none
+    long oom_kills, throttled;
+    double throttled_sec;
+};
+
+static struct job_stat job_stats[JOBSTATS_MAX];
+static int job_stats_next; // ring buffer position
+static struct job_stat job_totals;
+static double job_slow_threshold = 0; // print a summary for jobs slower than this, 0 is off
+
+double timeval_seconds(struct timeval tv) {
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/** CLOCK_MONOTONIC in nanoseconds */
+int64_t monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * A size in bytes: 4096, 512K, 1.5M, 2G
+ * @return -1 if it isn't one
+ */
+long long parse_size(const char *s) {
+    char *end;
+    double v = strtod(s, &end);
+    if (end == s || v <= 0) return -1;
+    if (*end == 'k' || *end == 'K') v *= 1024, end++;
+    else if (*end == 'm' || *end == 'M') v *= 1024 * 1024, end++;
+    else if (*end == 'g' || *end == 'G') v *= 1024 * 1024 * 1024, end++;
+    return *end == 0 ? (long long) v : -1;
+}
+
+/**
+ * Start tracking a forked job
+ * @param pid     [description]
+ * @param command [description]
+ */
+void job_started(pid_t pid, struct command_t *command) {
+    struct job_stat *job = &job_stats[job_stats_next];
+    job_stats_next = (job_stats_next + 1) % JOBSTATS_MAX;
+
+    free(job->name);
+    free(job->cgroup);
+    memset(job, 0, sizeof(struct job_stat));
+    job->pid = pid;
+    job->name = strdup(command->name);
+    job->background = command->background;
+    job->start = monotonic_ns();
+}
+
+/**
+ * Mark a job as run under limits
+ * @param pid    [description]
+ * @param cgroup its cgroup, removed when it is reaped, or NULL
+ */
+void job_limited(pid_t pid, const char *cgroup) {
+    for (int i = 0; i < JOBSTATS_MAX; i++)
+        if (job_stats[i].pid == pid && !job_stats[i].done) {
+            job_stats[i].limited = true;
+            job_stats[i].cgroup = cgroup ? strdup(cgroup) : NULL;
+        }
+}
+
+static void print_job_stat(struct job_stat *job) {
+    printf("[%d] %s: %.3fs wall, %.3fs user, %.3fs sys, %ld KB max rss, %ld/%ld faults, %ld/%ld ctx switches",
+           job->pid, job->name ? job->name : "?", job->wall, job->user, job->sys, job->maxrss,
+           job->minflt, job->majflt, job->nvcsw, job->nivcsw);
+    if (job->limited)
+        printf(", %ld oom kills, %.3fs throttled", job->oom_kills, job->throttled_sec);
+    printf("\n");
+}
+
+/** say when a job's limits stopped or slowed it */
+static void print_limit_events(struct job_stat *job) {
+    const char *name = job->name ? job->name : "?";
+    if (job->oom_kills > 0)
+        printf("[%d] %s: memory limit reached, %ld processes killed\n", job->pid, name, job->oom_kills);
+    if (WIFSIGNALED(job->status) && WTERMSIG(job->status) == SIGXCPU)
+        printf("[%d] %s: cpu time limit reached\n", job->pid, name);
+    if (job->throttled > 0)
+        printf("[%d] %s: throttled by its cpu limit %ld times, %.3fs in all\n", job->pid, name, job->throttled,
+               job->throttled_sec);
+}
+
+/**
+ * Record the resource usage of a reaped job
+ */
+void job_reaped(pid_t pid, int status, struct rusage *ru) {
+    struct job_stat *job = NULL;
+    for (int i = 0; i < JOBSTATS_MAX; i++)
+        if (job_stats[i].pid == pid && !job_stats[i].done)
+            job = &job_stats[i];
+    if (job == NULL)
+        return; // not a job, e.g. a helper of a builtin
+
+    job->done = true;
+    job->status = status;
+    job->wall = (monotonic_ns() - job->start) / 1e9;
+    job->user = timeval_seconds(ru->ru_utime);
+    job->sys = timeval_seconds(ru->ru_stime);
+    job->maxrss = ru->ru_maxrss;
+    job->minflt = ru->ru_minflt;
+    job->majflt = ru->ru_majflt;
+    job->nvcsw = ru->ru_nvcsw;
+    job->nivcsw = ru->ru_nivcsw;
+
+    job_totals.pid++; // number of jobs
+    job_totals.wall += job->wall;
+    job_totals.user += job->user;
+    job_totals.sys += job->sys;
+    if (job->maxrss > job_totals.maxrss)
+        job_totals.maxrss = job->maxrss;
+    job_totals.minflt += job->minflt;
+    job_totals.majflt += job->majflt;
+    job_totals.nvcsw += job->nvcsw;
+    job_totals.nivcsw += job->nivcsw;
+
+    if (job->cgroup != NULL) {
+        cgroup_finish(job->cgroup, &job->oom_kills, &job->throttled, &job->throttled_sec);
+        free(job->cgroup);
+        job->cgroup = NULL;
+    }
+    if (job->limited)
+        print_limit_events(job);
+
+    if (job_slow_threshold > 0 && job->wall >= job_slow_threshold)
+        print_job_stat(job);
+}
+
+/**
+ * Wait for a job to finish and record its resource usage
+ * @return the wait status
+ */
+int wait_job(pid_t pid) {
+    int status = 0;
+    struct rusage ru;
+    pid_t r;
+    while ((r = wait4(pid, &status, 0, &ru)) == -1 && errno == EINTR);
+    if (r > 0)
+        job_reaped(r, status, &ru);
+    return status;
+}
+
+/**
+ * Wait for whichever child finishes first and record it if it is a job
+ * @param  status its wait status
+ * @return        its pid, or -1 if there are no children
+ */
+pid_t wait_any_job(int *status) {
+    struct rusage ru;
+    pid_t pid;
+    while ((pid = wait4(-1, status, 0, &ru)) == -1 && errno == EINTR);
+    if (pid > 0)
+        job_reaped(pid, *status, &ru);
+    return pid;
+}
+
+/** reap finished background jobs without blocking */
+void reap_background_jobs() {
+    int status;
+    struct rusage ru;
+    pid_t pid;
+    while ((pid = wait4(-1, &status, WNOHANG, &ru)) > 0)
+        job_reaped(pid, status, &ru);
+}
+
+static int compare_jobs_cpu(const void *a, const void *b) {
+    const struct job_stat *x = *(struct job_stat **) a, *y = *(struct job_stat **) b;
+    double dx = x->user + x->sys, dy = y->user + y->sys;
+    return (dx < dy) - (dx > dy);
+}
+
+static int compare_jobs_rss(const void *a, const void *b) {
+    const struct job_stat *x = *(struct job_stat **) a, *y = *(struct job_stat **) b;
+    return (x->maxrss < y->maxrss) - (x->maxrss > y->maxrss);
+}
+
+/**
+ * jobstats [cpu|rss] [N]: top N jobs of this session by cpu time or max rss
+ * jobstats slow <seconds>: print a summary after commands slower than that, 0 turns it off
+ */
+void jobstats(struct command_t *command) {
+    if (command->arg_count > 0 && strcmp(command->args[0], "slow") == 0) {
+        if (command->arg_count > 1)
+            job_slow_threshold = atof(command->args[1]);
+        printf("slow command threshold: %.3fs%s\n", job_slow_threshold, job_slow_threshold > 0 ? "" : " (off)");
+        return;
+    }
+
+    int (*compare)(const void *, const void *) = compare_jobs_cpu;
+    int top = 10;
+    for (int i = 0; i < command->arg_count; i++) {
+        if (strcmp(command->args[i], "rss") == 0)
+            compare = compare_jobs_rss;
+        else if (strcmp(command->args[i], "cpu") == 0)
+            compare = compare_jobs_cpu;
+        else if (atoi(command->args[i]) > 0)
+            top = atoi(command->args[i]);
+        else {
+            printf("usage: jobstats [cpu|rss] [N] | jobstats slow <seconds>\n");
+            return;
+        }
+    }
+
+    struct job_stat *sorted[JOBSTATS_MAX];
+    int n = 0;
+    for (int i = 0; i < JOBSTATS_MAX; i++)
+        if (job_stats[i].done)
+            sorted[n++] = &job_stats[i];
+    qsort(sorted, n, sizeof(struct job_stat *), compare);
+
+    for (int i = 0; i < n && i < top; i++)
+        print_job_stat(sorted[i]);
+    printf("total: %d jobs, %.3fs wall, %.3fs user, %.3fs sys, %ld KB peak rss, %ld/%ld faults, %ld/%ld ctx switches\n",
+           job_totals.pid, job_totals.wall, job_totals.user, job_totals.sys, job_totals.maxrss,
+           job_totals.minflt, job_totals.majflt, job_totals.nvcsw, job_totals.nivcsw);
+}
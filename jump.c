@@ -0,0 +1,482 @@
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <limits.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "shellgibi.h"
+
+// frecency database of visited directories for cd and j, shared by every shell through a mmap'd file
+#define JUMP_MAGIC "SGJUMP1"
+#define JUMP_FILE ".shellgibi_dirs"
+#define JUMP_MIN_CAP 1024
+#define JUMP_MIN_ARENA (64 * 1024)
+#define JUMP_MAX_AGE 50000.0    // once the ranks add up to more than this they are all scaled down
+#define JUMP_LIST_MAX 10
+
+struct jump_header {
+    char magic[8];
+    uint32_t count, cap;        // entries used and room for
+    uint64_t arena_used, arena_cap;
+    double total;               // sum of the ranks
+    uint32_t stale;             // set once a rebuilt file has replaced this one
+    uint32_t pad;
+};
+
+struct jump_entry {
+    float rank;                 // visits, scaled down by aging, 0 once forgotten
+    uint32_t last;              // time of the last visit
+    uint64_t mask, base_mask;   // characters in the path and in its last component, to rule
+                                // out most entries without comparing strings
+    uint32_t hash;
+    uint32_t off;               // path in the arena, NUL terminated
+    uint16_t len, base;         // length of the path, and where its last component starts
+    uint32_t pad;
+};
+
+static int db_fd = -1;
+static size_t db_size;
+static struct jump_header *hdr;
+static uint32_t *slots;         // hash index of 2 * cap slots, entry + 1 or 0 if free
+static struct jump_entry *entries;
+static char *arena;
+
+static size_t db_bytes(uint32_t cap, uint64_t arena_cap) {
+    return sizeof(struct jump_header) + sizeof(uint32_t) * 2 * cap + sizeof(struct jump_entry) * cap + arena_cap;
+}
+
+static const char *db_path() {
+    static char path[PATH_MAX];
+    char *home = getenv("HOME");
+    if (home == NULL)
+        return NULL;
+    snprintf(path, sizeof(path), "%s/%s", home, JUMP_FILE);
+    return path;
+}
+
+static uint32_t path_hash(const char *s, size_t len) {
+    uint32_t h = 2166136261u; // FNV-1a
+    for (size_t i = 0; i < len; i++)
+        h = (h ^ (unsigned char) s[i]) * 16777619u;
+    return h;
+}
+
+static uint64_t char_mask(const char *s) {
+    uint64_t mask = 0;
+    for (; *s; s++)
+        mask |= 1ULL << (tolower((unsigned char) *s) & 63);
+    return mask;
+}
+
+static void set_pointers(char *map) {
+    hdr = (struct jump_header *) map;
+    slots = (uint32_t *) (map + sizeof(struct jump_header));
+    entries = (struct jump_entry *) (slots + 2 * hdr->cap);
+    arena = (char *) (entries + hdr->cap);
+}
+
+static void init_db(char *map, uint32_t cap, uint64_t arena_cap) {
+    memset(map, 0, sizeof(struct jump_header) + sizeof(uint32_t) * 2 * cap);
+    memcpy(map, JUMP_MAGIC, sizeof(JUMP_MAGIC));
+    struct jump_header *h = (struct jump_header *) map;
+    h->cap = cap;
+    h->arena_cap = arena_cap;
+}
+
+static void close_db() {
+    if (db_fd == -1)
+        return;
+    munmap(hdr, db_size);
+    close(db_fd);
+    db_fd = -1;
+    hdr = NULL;
+}
+
+/**
+ * Map the database, again if another shell has replaced it since
+ * @return 0, -1 if there is none and it can't be created
+ */
+static int open_db() {
+    if (db_fd != -1 && !hdr->stale)
+        return 0;
+    close_db();
+    const char *path = db_path();
+    if (path == NULL)
+        return -1;
+    int fd;
+    size_t size;
+    char *map;
+    while (1) {
+        if ((fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR)) == -1)
+            return -1;
+        flock(fd, LOCK_EX);
+        struct stat st;
+        fstat(fd, &st);
+        size = st.st_size;
+        map = MAP_FAILED;
+        if (size < sizeof(struct jump_header))
+            break;
+        map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        struct jump_header *h = (struct jump_header *) map;
+        if (map != MAP_FAILED && h->stale) { // replaced before we got the lock, open the new one
+            munmap(map, size);
+            flock(fd, LOCK_UN);
+            close(fd);
+            continue;
+        }
+        if (map != MAP_FAILED && (memcmp(h->magic, JUMP_MAGIC, sizeof(JUMP_MAGIC)) != 0
+                                  || db_bytes(h->cap, h->arena_cap) != size)) {
+            munmap(map, size); // not ours or cut short, start over
+            map = MAP_FAILED;
+        }
+        break;
+    }
+    if (map == MAP_FAILED) {
+        size = db_bytes(JUMP_MIN_CAP, JUMP_MIN_ARENA);
+        if (ftruncate(fd, 0) == -1 || ftruncate(fd, size) == -1
+            || (map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+            flock(fd, LOCK_UN);
+            close(fd);
+            return -1;
+        }
+        init_db(map, JUMP_MIN_CAP, JUMP_MIN_ARENA);
+    }
+    flock(fd, LOCK_UN);
+
+    db_fd = fd;
+    db_size = size;
+    set_pointers(map);
+    return 0;
+}
+
+/** lock the current database for writing */
+static int lock_db() {
+    while (1) {
+        if (open_db() == -1)
+            return -1;
+        flock(db_fd, LOCK_EX);
+        if (!hdr->stale)
+            return 0;
+        flock(db_fd, LOCK_UN); // replaced while we waited
+    }
+}
+
+static void unlock_db() {
+    flock(db_fd, LOCK_UN);
+}
+
+/**
+ * Find a path in the index
+ * @param  slot set to where it is, or to the free slot it would go in
+ * @return      its entry, -1 if it isn't there
+ */
+static int find_entry(const char *path, size_t len, uint32_t hash, uint32_t *slot) {
+    uint32_t mask = 2 * hdr->cap - 1;
+    for (uint32_t i = hash & mask;; i = (i + 1) & mask) {
+        if (slots[i] == 0) {
+            *slot = i;
+            return -1;
+        }
+        struct jump_entry *e = &entries[slots[i] - 1];
+        if (e->hash == hash && e->len == len && memcmp(arena + e->off, path, len) == 0) {
+            *slot = i;
+            return slots[i] - 1;
+        }
+    }
+}
+
+/** does an entry stay when the ranks are multiplied by factor? aging drops the ones it takes below 1 */
+static bool survives(struct jump_entry *e, double factor) {
+    return e->rank > 0 && (factor >= 1 || e->rank * factor >= 1);
+}
+
+/**
+ * Copy the live entries into a new file sized for them, with ranks multiplied by factor,
+ * and put it in place of the current one. Called with the lock held, returns with it released.
+ * @return 0, -1 if the current one had to be kept
+ */
+static int rebuild_db(double factor) {
+    uint32_t live = 0;
+    uint64_t live_arena = 0;
+    for (uint32_t i = 0; i < hdr->count; i++) {
+        if (survives(&entries[i], factor)) {
+            live++;
+            live_arena += entries[i].len + 1;
+        }
+    }
+    uint32_t cap = JUMP_MIN_CAP;
+    while (cap < 2 * live) cap *= 2;
+    uint64_t arena_cap = JUMP_MIN_ARENA;
+    while (arena_cap < 2 * live_arena) arena_cap *= 2;
+
+    char tmp[PATH_MAX];
+    snprintf(tmp, sizeof(tmp), "%s.%d", db_path(), getpid());
+    size_t size = db_bytes(cap, arena_cap);
+    int fd = open(tmp, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    char *map = MAP_FAILED;
+    if (fd != -1 && ftruncate(fd, size) != -1)
+        map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        if (fd != -1) {
+            close(fd);
+            unlink(tmp);
+        }
+        unlock_db();
+        return -1;
+    }
+    init_db(map, cap, arena_cap);
+    struct jump_header *h = (struct jump_header *) map;
+    uint32_t *new_slots = (uint32_t *) (map + sizeof(struct jump_header));
+    struct jump_entry *new_entries = (struct jump_entry *) (new_slots + 2 * cap);
+    char *new_arena = (char *) (new_entries + cap);
+    for (uint32_t i = 0; i < hdr->count; i++) {
+        if (!survives(&entries[i], factor))
+            continue;
+        struct jump_entry e = entries[i];
+        e.rank *= factor;
+        memcpy(new_arena + h->arena_used, arena + e.off, e.len + 1);
+        e.off = h->arena_used;
+        h->arena_used += e.len + 1;
+        uint32_t s = e.hash & (2 * cap - 1);
+        while (new_slots[s] != 0)
+            s = (s + 1) & (2 * cap - 1);
+        new_slots[s] = h->count + 1;
+        new_entries[h->count++] = e;
+        h->total += e.rank;
+    }
+
+    if (rename(tmp, db_path()) == -1) {
+        munmap(map, size);
+        close(fd);
+        unlink(tmp);
+        unlock_db();
+        return -1;
+    }
+    hdr->stale = 1; // tell the other shells to map the new one
+    unlock_db();
+    close_db();
+    db_fd = fd;
+    db_size = size;
+    set_pointers(map);
+    return 0;
+}
+
+/**
+ * Record a visit to a directory: one more to its rank, now as its last visit
+ * @param dir absolute path
+ */
+void jump_visit(const char *dir) {
+    size_t len = strlen(dir);
+    uint32_t hash = path_hash(dir, len), slot;
+    if (len >= PATH_MAX || lock_db() == -1)
+        return;
+    int i;
+    while ((i = find_entry(dir, len, hash, &slot)) == -1
+           && (hdr->count == hdr->cap || hdr->arena_used + len + 1 > hdr->arena_cap)) {
+        if (rebuild_db(1) == -1 || lock_db() == -1) // full, grow it
+            return;
+    }
+    if (i == -1) {
+        struct jump_entry *e = &entries[hdr->count];
+        memcpy(arena + hdr->arena_used, dir, len + 1);
+        e->off = hdr->arena_used;
+        e->len = len;
+        e->hash = hash;
+        e->mask = char_mask(dir);
+        e->base = strrchr(dir, '/') ? strrchr(dir, '/') + 1 - dir : 0;
+        e->base_mask = char_mask(dir + e->base);
+        e->rank = 0;
+        hdr->arena_used += len + 1;
+        i = hdr->count;
+        slots[slot] = i + 1;
+        hdr->count++; // last, so readers never see a half written entry
+    }
+    entries[i].rank += 1;
+    entries[i].last = time(NULL);
+    hdr->total += 1;
+
+    if (hdr->total > JUMP_MAX_AGE)
+        rebuild_db(0.9 * JUMP_MAX_AGE / hdr->total);
+    else
+        unlock_db();
+}
+
+/** drop a directory that is gone, it comes back if it is visited again */
+static void jump_forget(const char *dir) {
+    size_t len = strlen(dir);
+    uint32_t slot;
+    if (lock_db() == -1)
+        return;
+    int i = find_entry(dir, len, path_hash(dir, len), &slot);
+    if (i != -1) {
+        hdr->total -= entries[i].rank;
+        entries[i].rank = 0;
+    }
+    unlock_db();
+}
+
+/** rank weighted by how long ago the last visit was */
+static double frecency(struct jump_entry *e, uint32_t now) {
+    uint32_t age = now - e->last;
+    if (age < 3600) return e->rank * 4;
+    if (age < 86400) return e->rank * 2;
+    if (age < 7 * 86400) return e->rank / 2;
+    return e->rank / 4;
+}
+
+static const char *find_fragment(const char *s, const char *fragment, bool fold) {
+    return fold ? strcasestr(s, fragment) : strstr(s, fragment);
+}
+
+/**
+ * Do the fragments occur in the path in order, with the last one in its last component?
+ */
+static bool jump_matches(struct jump_entry *e, char **fragments, int count, bool fold) {
+    const char *path = arena + e->off, *last = fragments[count - 1], *q, *r;
+    size_t len = strlen(last);
+    // the last occurrence of the last fragment is the one that leaves the most room for the others
+    if (strchr(last, '/') == NULL) { // then it has to be in the last component, a short string to search
+        if ((q = find_fragment(path + e->base, last, fold)) == NULL)
+            return false;
+    } else {
+        if ((q = find_fragment(path, last, fold)) == NULL)
+            return false;
+    }
+    while ((r = find_fragment(q + 1, last, fold)) != NULL)
+        q = r;
+    if (strchr(q + len, '/') != NULL)
+        return false;
+
+    const char *p = path;
+    for (int k = 0; k < count - 1; k++) {
+        r = find_fragment(p, fragments[k], fold);
+        if (r == NULL || r + strlen(fragments[k]) > q)
+            return false;
+        p = r + strlen(fragments[k]);
+    }
+    return true;
+}
+
+static int jump_best(char **fragments, int count, const char *cwd, bool fold) {
+    uint64_t need = 0, need_base = 0;
+    for (int k = 0; k < count; k++)
+        need |= char_mask(fragments[k]);
+    if (strchr(fragments[count - 1], '/') == NULL)
+        need_base = char_mask(fragments[count - 1]);
+    uint32_t now = time(NULL), n = hdr->count;
+    double best_score = 0;
+    int best = -1;
+    for (uint32_t i = 0; i < n; i++) {
+        struct jump_entry *e = &entries[i];
+        if (e->rank <= 0 || (e->mask & need) != need || (e->base_mask & need_base) != need_base)
+            continue;
+        double score = frecency(e, now);
+        if (score <= best_score) // cheap checks first, most entries never get compared
+            continue;
+        if (jump_matches(e, fragments, count, fold) && strcmp(arena + e->off, cwd) != 0) {
+            best_score = score;
+            best = i;
+        }
+    }
+    return best;
+}
+
+/**
+ * Find the directory with the highest frecency that matches all fragments, case-insensitively if no
+ * directory matches them as they are. The current directory is never the answer.
+ * @return  path in the database, valid until the next visit; NULL if none matches
+ */
+const char *jump_find(char **fragments, int count) {
+    if (open_db() == -1)
+        return NULL;
+    char cwd[PATH_MAX];
+    if (getcwd(cwd, sizeof(cwd)) == NULL)
+        cwd[0] = 0;
+    int i = jump_best(fragments, count, cwd, false);
+    if (i == -1)
+        i = jump_best(fragments, count, cwd, true);
+    return i == -1 ? NULL : arena + entries[i].off;
+}
+
+/**
+ * chdir, keeping PWD and OLDPWD and recording the visit
+ * @return 0, -1 with errno set if chdir failed
+ */
+int change_directory(const char *dir) {
+    char old[PATH_MAX], cwd[PATH_MAX];
+    bool have_old = getcwd(old, sizeof(old)) != NULL;
+    if (chdir(dir) == -1)
+        return -1;
+    if (have_old)
+        setenv("OLDPWD", old, 1);
+    if (getcwd(cwd, sizeof(cwd)) != NULL) {
+        setenv("PWD", cwd, 1);
+        jump_visit(cwd);
+    }
+    return 0;
+}
+
+static void jump_list() {
+    struct jump_entry *top[JUMP_LIST_MAX];
+    double scores[JUMP_LIST_MAX];
+    int count = 0;
+    if (open_db() == -1)
+        return;
+    uint32_t now = time(NULL);
+    for (uint32_t i = 0; i < hdr->count; i++) {
+        if (entries[i].rank <= 0)
+            continue;
+        double score = frecency(&entries[i], now);
+        int pos = count < JUMP_LIST_MAX ? count++ : JUMP_LIST_MAX;
+        while (pos > 0 && scores[pos - 1] < score) {
+            if (pos < JUMP_LIST_MAX) {
+                top[pos] = top[pos - 1];
+                scores[pos] = scores[pos - 1];
+            }
+            pos--;
+        }
+        if (pos < JUMP_LIST_MAX) {
+            top[pos] = &entries[i];
+            scores[pos] = score;
+        }
+    }
+    for (int i = 0; i < count; i++)
+        printf("%10.1f  %s\n", scores[i], arena + top[i]->off);
+}
+
+/**
+ * j fragment...: cd to the most frecent directory matching the fragments, j alone lists the top ones
+ */
+int jump(struct command_t *command) {
+    if (command->arg_count == 0) {
+        jump_list();
+        return SUCCESS;
+    }
+    const char *found;
+    while ((found = jump_find(command->args, command->arg_count)) != NULL) {
+        char *dir = strdup(found);
+        if (change_directory(dir) == 0) {
+            free(dir);
+            return SUCCESS;
+        }
+        if (errno != ENOENT && errno != ENOTDIR) {
+            printf("-%s: j: %s: %s\n", sysname, dir, strerror(errno));
+            free(dir);
+            last_status = 1;
+            return SUCCESS;
+        }
+        jump_forget(dir); // removed since we were there, try the next best
+        free(dir);
+    }
+    printf("-%s: j: no directory matches\n", sysname);
+    last_status = 1;
+    return SUCCESS;
+}
@@ -0,0 +1,322 @@
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+
+#include "shellgibi.h"
+
+// for limit
+#define LIMIT_USAGE "usage: limit [-m size[K|M|G]] [-c cpu%%] [-t cpu seconds] cmd args...\n"
+#define CGROUP_PERIOD 100000 // cpu.max period, microseconds
+
+struct job_limits {
+    long long memory;           // bytes, 0 for none
+    long cpu_percent;           // of one cpu, 0 for none
+    long cpu_seconds;           // 0 for none
+    char cgroup[PATH_MAX];      // the job's own cgroup, empty if it only gets rlimits
+    bool cgroup_memory, cgroup_cpu; // which limits its cgroup has, the memory cap is an rlimit otherwise
+};
+
+// the shell's move into a leaf cgroup, undone at exit
+static struct {
+    pid_t shell;                // the process that moved, not its forked children that exit too
+    char leaf[PATH_MAX];
+    bool enabled[2];            // memory and cpu were turned on by us in the parent's subtree_control
+} shell_move;
+
+static struct job_limits *pending; // for the child launch_command is about to fork
+
+static bool cgroup_write(const char *cgroup, const char *file, const char *value) {
+    char path[PATH_MAX + 64];
+    snprintf(path, sizeof(path), "%s/%s", cgroup, file);
+    int fd = open(path, O_WRONLY | O_CLOEXEC);
+    if (fd == -1)
+        return false;
+    bool ok = write(fd, value, strlen(value)) == (ssize_t) strlen(value);
+    close(fd);
+    return ok;
+}
+
+/**
+ * Value of a "key value" line of a cgroup file like memory.events
+ * @return -1 if there is no such file or key
+ */
+static long long cgroup_read_key(const char *cgroup, const char *file, const char *key) {
+    char path[PATH_MAX + 64], line[256];
+    snprintf(path, sizeof(path), "%s/%s", cgroup, file);
+    FILE *f = fopen(path, "re");
+    if (f == NULL)
+        return -1;
+    long long value = -1;
+    size_t len = strlen(key);
+    while (fgets(line, sizeof(line), f))
+        if (strncmp(line, key, len) == 0 && line[len] == ' ') {
+            value = atoll(line + len + 1);
+            break;
+        }
+    fclose(f);
+    return value;
+}
+
+/** the cgroup v2 directory the shell is in, from mountinfo and /proc/self/cgroup */
+static bool cgroup_self(char *out, size_t size) {
+    char line[PATH_MAX * 2], mount[PATH_MAX] = "", rel[PATH_MAX] = "";
+    FILE *f = fopen("/proc/self/mountinfo", "re");
+    if (f == NULL)
+        return false;
+    while (fgets(line, sizeof(line), f)) {
+        char *sep = strstr(line, " - cgroup2 ");
+        if (sep != NULL && sscanf(line, "%*s %*s %*s %*s %4095s", mount) == 1)
+            break;
+        mount[0] = 0;
+    }
+    fclose(f);
+    if ((f = fopen("/proc/self/cgroup", "re")) == NULL)
+        return false;
+    while (fgets(line, sizeof(line), f))
+        if (strncmp(line, "0::", 3) == 0) {
+            snprintf(rel, sizeof(rel), "%s", line + 3);
+            rel[strcspn(rel, "\n")] = 0;
+        }
+    fclose(f);
+    if (mount[0] == 0 || rel[0] == 0)
+        return false;
+    snprintf(out, size, "%s%s", mount, strcmp(rel, "/") == 0 ? "" : rel);
+    return true;
+}
+
+/** is a controller listed in cgroup.controllers or cgroup.subtree_control */
+static bool cgroup_has(const char *cgroup, const char *file, const char *controller) {
+    char path[PATH_MAX + 64], line[256], *save;
+    snprintf(path, sizeof(path), "%s/%s", cgroup, file);
+    FILE *f = fopen(path, "re");
+    if (f == NULL)
+        return false;
+    bool found = false;
+    if (fgets(line, sizeof(line), f))
+        for (char *word = strtok_r(line, " \n", &save); word; word = strtok_r(NULL, " \n", &save))
+            found |= strcmp(word, controller) == 0;
+    fclose(f);
+    return found;
+}
+
+/** make a controller available to the cgroups under this one */
+static bool cgroup_enable(const char *cgroup, const char *controller) {
+    if (cgroup_has(cgroup, "cgroup.subtree_control", controller))
+        return true;
+    char value[64];
+    snprintf(value, sizeof(value), "+%s", controller);
+    return cgroup_write(cgroup, "cgroup.subtree_control", value);
+}
+
+/** at exit: hand the controllers back, leave the leaf for the cgroup we came from and remove it */
+static void cgroup_restore() {
+    if (getpid() != shell_move.shell)
+        return;
+    char parent[PATH_MAX];
+    snprintf(parent, sizeof(parent), "%s", shell_move.leaf);
+    *strrchr(parent, '/') = 0;
+    const char *off[] = {"-memory", "-cpu"};
+    for (int i = 0; i < 2; i++)
+        if (shell_move.enabled[i])
+            cgroup_write(parent, "cgroup.subtree_control", off[i]);
+    if (cgroup_write(parent, "cgroup.procs", "0"))
+        rmdir(shell_move.leaf); // unless another shell is using it
+}
+
+/**
+ * Where job cgroups go, worked out once. cgroup v2 only lets a cgroup hand controllers down while no process
+ * is in it, so unless the shell is in the root cgroup it moves itself into a shell leaf of its cgroup, which
+ * then gets the controllers, and the jobs get cgroups beside that leaf.
+ * @return NULL if there is no cgroup v2 with memory or cpu controllers for us to use
+ */
+static const char *cgroup_parent() {
+    static char parent[PATH_MAX - 128];
+    static int state; // 0 not tried yet, 1 parent is set up, -1 no use trying again
+    if (state != 0)
+        return state == 1 ? parent : NULL;
+    state = -1;
+    if (!cgroup_self(parent, sizeof(parent)))
+        return NULL;
+
+    char leaf[PATH_MAX], type[PATH_MAX];
+    snprintf(leaf, sizeof(leaf), "%s/shell", parent);
+    snprintf(type, sizeof(type), "%s/cgroup.type", parent);
+    bool moved = false;
+    if (access(type, F_OK) == 0) { // only the root cgroup has no type, and processes may stay there
+        if ((mkdir(leaf, S_IRWXU) == -1 && errno != EEXIST) || !cgroup_write(leaf, "cgroup.procs", "0")) {
+            rmdir(leaf);
+            return NULL;
+        }
+        moved = true;
+    }
+
+    bool ok = false, enabled[2] = {false, false};
+    const char *controllers[] = {"memory", "cpu"};
+    for (int i = 0; i < 2; i++)
+        if (cgroup_has(parent, "cgroup.controllers", controllers[i])) {
+            enabled[i] = !cgroup_has(parent, "cgroup.subtree_control", controllers[i]);
+            enabled[i] &= cgroup_enable(parent, controllers[i]);
+            ok |= cgroup_has(parent, "cgroup.subtree_control", controllers[i]);
+        }
+    if (!ok) { // another process in our cgroup, or nothing delegated to us: go back to where we were
+        if (moved) {
+            cgroup_write(parent, "cgroup.procs", "0");
+            rmdir(leaf); // unless another shell is using it
+        }
+        return NULL;
+    }
+    if (moved) {
+        shell_move.shell = getpid();
+        snprintf(shell_move.leaf, sizeof(shell_move.leaf), "%s", leaf);
+        memcpy(shell_move.enabled, enabled, sizeof(enabled));
+        atexit(cgroup_restore);
+        fprintf(stderr, "-%s: limit: moved the shell to %s, its jobs get cgroups beside it\n", sysname, leaf);
+    }
+    state = 1;
+    return parent;
+}
+
+/**
+ * Make a cgroup for the job beside the shell's own, with memory.max and cpu.max as far as each controller
+ * is ours to use, and note which of them it got in l->cgroup_memory and l->cgroup_cpu
+ * @return false if it got neither
+ */
+static bool cgroup_create(struct job_limits *l) {
+    static int jobs;
+    char value[64];
+    const char *base = cgroup_parent();
+    if (base == NULL)
+        return false;
+    bool memory = l->memory && cgroup_enable(base, "memory");
+    bool cpu = l->cpu_percent && cgroup_enable(base, "cpu");
+    if (!memory && !cpu)
+        return false;
+    snprintf(l->cgroup, sizeof(l->cgroup), "%s/shellgibi.%d.%d", base, getpid(), ++jobs);
+    if (mkdir(l->cgroup, S_IRWXU) == -1) {
+        l->cgroup[0] = 0;
+        return false;
+    }
+    if (memory) {
+        snprintf(value, sizeof(value), "%lld", l->memory);
+        l->cgroup_memory = cgroup_write(l->cgroup, "memory.max", value);
+        cgroup_write(l->cgroup, "memory.swap.max", "0"); // or it swaps rather than reaching the limit, if there is swap
+    }
+    if (cpu) {
+        snprintf(value, sizeof(value), "%ld %d", l->cpu_percent * CGROUP_PERIOD / 100, CGROUP_PERIOD);
+        l->cgroup_cpu = cgroup_write(l->cgroup, "cpu.max", value);
+    }
+    if (!l->cgroup_memory && !l->cgroup_cpu) {
+        rmdir(l->cgroup);
+        l->cgroup[0] = 0;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Read what the limits did to a finished job and remove its cgroup
+ * @param cgroup        [description]
+ * @param oom_kills     processes the memory limit killed
+ * @param throttled     periods the cpu limit stopped it in
+ * @param throttled_sec [description]
+ */
+void cgroup_finish(const char *cgroup, long *oom_kills, long *throttled, double *throttled_sec) {
+    long long v;
+    *oom_kills = (v = cgroup_read_key(cgroup, "memory.events", "oom_kill")) > 0 ? v : 0;
+    *throttled = (v = cgroup_read_key(cgroup, "cpu.stat", "nr_throttled")) > 0 ? v : 0;
+    *throttled_sec = (v = cgroup_read_key(cgroup, "cpu.stat", "throttled_usec")) > 0 ? v / 1e6 : 0;
+    rmdir(cgroup); // fails while a daemonized descendant is still in it, which can keep it then
+}
+
+/** in the child between fork and exec: join the job's cgroup and set the rlimits */
+void limit_child() {
+    if (pending == NULL)
+        return;
+    if (pending->cgroup[0] && !cgroup_write(pending->cgroup, "cgroup.procs", "0")) {
+        fprintf(stderr, "-%s: limit: %s: %s\n", sysname, pending->cgroup, strerror(errno));
+        exit(126);
+    }
+    struct rlimit rl;
+    if (pending->memory && !pending->cgroup_memory) {
+        rl.rlim_cur = rl.rlim_max = pending->memory;
+        if (setrlimit(RLIMIT_AS, &rl) == -1) {
+            fprintf(stderr, "-%s: limit: memory: %s\n", sysname, strerror(errno));
+            exit(126);
+        }
+    }
+    if (pending->cpu_seconds) {
+        rl.rlim_cur = pending->cpu_seconds;
+        rl.rlim_max = pending->cpu_seconds + 1; // SIGXCPU, then SIGKILL if it ignores that
+        if (setrlimit(RLIMIT_CPU, &rl) == -1) {
+            fprintf(stderr, "-%s: limit: cpu time: %s\n", sysname, strerror(errno));
+            exit(126);
+        }
+    }
+}
+
+/**
+ * limit [-m size] [-c cpu%] [-t seconds] cmd args...: run a command, or a pipeline, with a memory cap,
+ * a share of the cpu and a cpu time limit. Memory and cpu share go in a cgroup of its own when cgroup v2
+ * is writable, otherwise memory is an RLIMIT_AS and the cpu share can't be had. The cpu time is an
+ * RLIMIT_CPU either way.
+ */
+int limit(struct command_t *command, int in_fd) {
+    struct job_limits l = {0};
+    int first = 0;
+    while (first < command->arg_count && command->args[first][0] == '-') {
+        char *opt = command->args[first], *value = first + 1 < command->arg_count ? command->args[first + 1] : NULL;
+        char *end = "";
+        if (value != NULL && strcmp(opt, "-m") == 0)
+            l.memory = parse_size(value);
+        else if (value != NULL && strcmp(opt, "-c") == 0)
+            l.cpu_percent = strtol(value, &end, 10);
+        else if (value != NULL && strcmp(opt, "-t") == 0)
+            l.cpu_seconds = strtol(value, &end, 10);
+        else
+            l.memory = -1;
+        if (l.memory < 0 || l.cpu_percent < 0 || l.cpu_seconds < 0 || (*end != 0 && strcmp(end, "%") != 0)) {
+            printf(LIMIT_USAGE);
+            last_status = 2;
+            return SUCCESS;
+        }
+        first += 2;
+    }
+    if (first >= command->arg_count) {
+        printf(LIMIT_USAGE);
+        last_status = 2;
+        return SUCCESS;
+    }
+
+    bool cgroup = (l.memory || l.cpu_percent) && cgroup_create(&l);
+    if (!l.cgroup_cpu && l.cpu_percent) {
+        printf("-%s: limit: no writable cgroup v2 cpu controller, -c is ignored\n", sysname);
+        l.cpu_percent = 0;
+    }
+
+    // the command after the options, with an args array of its own as launch_command grows it
+    struct command_t job = *command;
+    job.name = command->args[first];
+    job.arg_count = command->arg_count - first - 1;
+    job.args = malloc(sizeof(char *) * (job.arg_count + 1));
+    memcpy(job.args, command->args + first + 1, sizeof(char *) * job.arg_count);
+
+    pending = &l;
+    pid_t pid = launch_command(&job, in_fd);
+    pending = NULL;
+    free(job.args);
+    if (pid == -1) {
+        if (cgroup)
+            rmdir(l.cgroup);
+        return UNKNOWN;
+    }
+    job_limited(pid, cgroup ? l.cgroup : NULL);
+    if (!command->background)
+        last_status = exit_status(wait_job(pid));
+    return SUCCESS;
+}
@@ -0,0 +1,286 @@
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+
+#include "shellgibi.h"
+
+// for meter
+#define METER_USAGE "usage: meter [-l] [-p pipe size] cmd args | cmd args ...\n"
+#define METER_SPLICE_MAX (1024 * 1024)
+#define METER_LIVE_NS 1000000000LL
+
+// the shell's hop between a stage's stdout and the next stage's stdin
+struct meter_link {
+    int in, out;                // read end of the stage's stdout, write end of the next stage's stdin
+    bool want_out;              // data is waiting for room downstream
+    bool done, can_splice;
+    long long bytes;
+    int64_t finished;           // when the link closed
+    int64_t starved_ns;         // in poll waiting for the stage before to write
+    int64_t blocked_ns;         // in poll waiting for the stage after to read
+};
+
+static pid_t meter_launch(char *path, char **argv, struct command_t *stage, int in, int out) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        signal(SIGPIPE, SIG_DFL); // the shell ignores it while metering, an ignored signal survives exec
+        if (stage->redirects[0] != NULL) {
+            int fd = open(stage->redirects[0], O_RDONLY);
+            if (fd == -1) { // on stderr, stdout is the data being metered
+                fprintf(stderr, "-%s: %s: %s\n", sysname, stage->redirects[0], strerror(errno));
+                exit(1);
+            }
+            in = fd;
+        } else if (stage->heredoc > 0)
+            in = stage->heredoc;
+        if (stage->redirects[1] != NULL)
+            out = open(stage->redirects[1], O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+        else if (stage->redirects[2] != NULL)
+            out = open(stage->redirects[2], O_WRONLY | O_CREAT | O_APPEND, S_IRUSR | S_IWUSR);
+        dup2(in, STDIN_FILENO); // everything else is close-on-exec
+        dup2(out, STDOUT_FILENO);
+        execv(path, argv);
+        exec_failed(argv[0]);
+    }
+    if (pid > 0)
+        job_started(pid, stage);
+    return pid;
+}
+
+static void link_close(struct meter_link *l, int64_t now) {
+    close(l->in);
+    if (l->out != STDOUT_FILENO)
+        close(l->out); // the next stage sees the end of its input
+    l->done = true;
+    l->finished = now;
+}
+
+/**
+ * Move what is available from one side to the other until either end would block
+ */
+static void link_pump(struct meter_link *l, int64_t now) {
+    while (1) {
+        ssize_t n;
+        if (l->can_splice) {
+            n = splice(l->in, NULL, l->out, NULL, METER_SPLICE_MAX, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (n == -1 && errno == EINVAL) { // stdout is something splice can't write to
+                l->can_splice = false;
+                continue;
+            }
+        } else {
+            static char buf[65536];
+            n = read(l->in, buf, sizeof(buf));
+            if (n > 0) { // only the last link copies, and only to a terminal or the like, so just block
+                for (ssize_t done = 0, w; done < n; done += w)
+                    if ((w = write(l->out, buf + done, n - done)) <= 0) {
+                        if (w == -1 && errno == EINTR) { w = 0; continue; }
+                        link_close(l, now);
+                        return;
+                    }
+            }
+        }
+        if (n > 0) {
+            l->bytes += n;
+            continue;
+        }
+        if (n == 0) {
+            link_close(l, now);
+            return;
+        }
+        if (errno == EINTR)
+            continue;
+        if (errno != EAGAIN) { // the reader is gone
+            link_close(l, now);
+            return;
+        }
+        int queued = 0;
+        l->want_out = ioctl(l->in, FIONREAD, &queued) == 0 && queued > 0; // there is data, so the other side is full
+        return;
+    }
+}
+
+static void meter_live(struct meter_link *links, int count, int64_t start, int64_t now) {
+    double t = (now - start) / 1e9;
+    fprintf(stderr, "\r%6.1fs", t);
+    for (int i = 0; i < count; i++)
+        fprintf(stderr, "  %s%.1fMB/s", i ? "| " : "", t > 0 ? links[i].bytes / t / 1e6 : 0);
+    fprintf(stderr, " ");
+}
+
+static void meter_report(struct meter_link *links, char **names, int count, int64_t start, int64_t end, int pipe_size) {
+    double wall = (end - start) / 1e9;
+    printf("meter: %d stages in %.2fs, pipes of %dKB\n", count, wall, pipe_size / 1024);
+    printf("%-28s %14s %10s %16s %16s\n", "link", "bytes", "MB/s", "waiting on left", "blocked by right");
+    int bottleneck = 0;
+    double worst = -1;
+    for (int i = 0; i < count; i++) {
+        struct meter_link *l = &links[i];
+        double active = (l->finished - start) / 1e9;
+        char name[64];
+        snprintf(name, sizeof(name), "%.12s -> %.12s", names[i], i + 1 < count ? names[i + 1] : "out");
+        printf("%-28s %14lld %10.1f %15.1f%% %15.1f%%\n", name, l->bytes, active > 0 ? l->bytes / active / 1e6 : 0,
+               active > 0 ? l->starved_ns / 1e9 / active * 100 : 0, active > 0 ? l->blocked_ns / 1e9 / active * 100 : 0);
+
+        // a stage is slow when the link after it waits on it and the link before it is blocked by it
+        double waited_on = active > 0 ? l->starved_ns / 1e9 / active : 0;
+        if (i > 0 && links[i - 1].finished > start)
+            waited_on += links[i - 1].blocked_ns / 1e9 / ((links[i - 1].finished - start) / 1e9);
+        if (waited_on > worst) {
+            worst = waited_on;
+            bottleneck = i;
+        }
+    }
+    if (count > 1)
+        printf("bottleneck: %s\n", names[bottleneck]);
+}
+
+/**
+ * meter [-l] [-p size] cmd | cmd ...: run a pipeline with the shell between its stages, moving the data
+ * with splice and measuring each hop. -l prints the rates every second, -p sets the pipe sizes.
+ */
+int meter(struct command_t *command, int in_fd) {
+    bool live = false;
+    long pipe_size = 0;
+    int first = 0;
+    while (first < command->arg_count && command->args[first][0] == '-') {
+        if (strcmp(command->args[first], "-l") == 0) {
+            live = true;
+            first++;
+        } else if (strcmp(command->args[first], "-p") == 0 && first + 1 < command->arg_count
+                   && (pipe_size = parse_size(command->args[first + 1])) > 0) {
+            first += 2;
+        } else {
+            printf(METER_USAGE);
+            return SUCCESS;
+        }
+    }
+    if (first >= command->arg_count) {
+        printf(METER_USAGE);
+        return SUCCESS;
+    }
+
+    // the first stage is in our args, the others are the rest of the pipeline
+    struct command_t head = *command;
+    head.name = command->args[first];
+    head.args = command->args + first + 1;
+    head.arg_count = command->arg_count - first - 1;
+    int count = 0;
+    for (struct command_t *c = &head; c; c = c->next)
+        count++;
+    struct command_t **stages = malloc(sizeof(struct command_t *) * count);
+    char **paths = calloc(count, sizeof(char *)), **names = malloc(sizeof(char *) * count);
+    int i = 0;
+    for (struct command_t *c = &head; c; c = c->next, i++) {
+        stages[i] = c;
+        names[i] = c->name;
+        if ((paths[i] = resolve_command(c->name)) == NULL) {
+            command_not_found(c->name);
+            for (int j = 0; j < i; j++)
+                free(paths[j]);
+            free(paths);
+            free(names);
+            free(stages);
+            last_status = 127;
+            return UNKNOWN;
+        }
+    }
+
+    void (*old_pipe)(int) = signal(SIGPIPE, SIG_IGN); // a stage that quits early is an EPIPE for us
+    struct meter_link *links = calloc(count, sizeof(struct meter_link));
+    pid_t *pids = malloc(sizeof(pid_t) * count);
+    int actual_size = 0;
+    int64_t start = monotonic_ns();
+    int in = in_fd;
+    for (i = 0; i < count; i++) {
+        int up[2], down[2] = {-1, STDOUT_FILENO};
+        pipe2(up, O_CLOEXEC);
+        if (i + 1 < count)
+            pipe2(down, O_CLOEXEC);
+        if (pipe_size > 0) {
+            fcntl(up[1], F_SETPIPE_SZ, pipe_size);
+            if (down[0] != -1)
+                fcntl(down[1], F_SETPIPE_SZ, pipe_size);
+        }
+        actual_size = fcntl(up[1], F_GETPIPE_SZ);
+
+        char **argv = malloc(sizeof(char *) * (stages[i]->arg_count + 2));
+        argv[0] = stages[i]->name;
+        memcpy(argv + 1, stages[i]->args, sizeof(char *) * stages[i]->arg_count);
+        argv[stages[i]->arg_count + 1] = NULL;
+        pids[i] = meter_launch(paths[i], argv, stages[i], in, up[1]);
+        free(argv);
+
+        close(up[1]);
+        if (in != in_fd)
+            close(in);
+        in = down[0];
+        fcntl(up[0], F_SETFL, O_NONBLOCK);
+        if (down[1] != STDOUT_FILENO)
+            fcntl(down[1], F_SETFL, O_NONBLOCK);
+        links[i] = (struct meter_link) {up[0], down[1], false, false, true, 0, 0, 0, 0};
+    }
+
+    struct pollfd *fds = malloc(sizeof(struct pollfd) * count);
+    int *which = malloc(sizeof(int) * count);
+    int64_t next_live = start + METER_LIVE_NS;
+    while (1) {
+        int n = 0;
+        for (i = 0; i < count; i++) {
+            if (links[i].done)
+                continue;
+            fds[n].fd = links[i].want_out ? links[i].out : links[i].in;
+            fds[n].events = links[i].want_out ? POLLOUT : POLLIN;
+            which[n++] = i;
+        }
+        if (n == 0)
+            break;
+        int64_t waited = monotonic_ns();
+        int timeout = live ? (int) ((next_live - waited) / 1000000) : -1;
+        if (poll(fds, n, live && timeout < 0 ? 0 : timeout) == -1 && errno != EINTR)
+            break;
+        int64_t now = monotonic_ns();
+        for (int k = 0; k < n; k++) { // only the time in poll is waiting, splicing is the link at work
+            if (links[which[k]].want_out)
+                links[which[k]].blocked_ns += now - waited;
+            else
+                links[which[k]].starved_ns += now - waited;
+        }
+        for (int k = 0; k < n; k++)
+            if (fds[k].revents)
+                link_pump(&links[which[k]], now);
+        if (live && now >= next_live) {
+            meter_live(links, count, start, now);
+            next_live += METER_LIVE_NS;
+        }
+    }
+    if (live)
+        fprintf(stderr, "\n");
+
+    for (i = 0; i < count; i++)
+        if (pids[i] > 0) {
+            int status = wait_job(pids[i]);
+            if (i == count - 1)
+                last_status = exit_status(status);
+        }
+    signal(SIGPIPE, old_pipe);
+    meter_report(links, names, count, start, monotonic_ns(), actual_size);
+
+    for (i = 0; i < count; i++)
+        free(paths[i]);
+    free(paths);
+    free(names);
+    free(stages);
+    free(links);
+    free(pids);
+    free(fds);
+    free(which);
+    return SUCCESS;
+}
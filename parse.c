@@ -0,0 +1,856 @@
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+
+#include "shellgibi.h"
+
+/**
+ * Prints a command struct
+ * @param struct command_t *
+ */
+void print_command(struct command_t *command) {
+    int i = 0;
+    printf("Command: <%s>\n", command->name);
+    if (command->source)
+        printf("\tNot parsed yet: %s\n", command->source);
+    printf("\tIs Background: %s\n", command->background ? "yes" : "no");
+    printf("\tNeeds Auto-complete: %s\n", command->auto_complete ? "yes" : "no");
+    printf("\tRedirects:\n");
+    for (i = 0; i < 3; i++)
+        printf("\t\t%d: %s\n", i, command->redirects[i] ? command->redirects[i] : "N/A");
+    printf("\tArguments (%d):\n", command->arg_count);
+    for (i = 0; i < command->arg_count; ++i)
+        printf("\t\tArg %d: %s\n", i, command->args[i]);
+    if (command->next) {
+        printf("\tPiped to:\n");
+        print_command(command->next);
+    }
+    if (command->group) {
+        printf("\tGroup:\n");
+        print_command(command->group);
+    }
+    if (command->then) {
+        printf("\tThen (%s):\n", command->op == LIST_AND ? "&&" : command->op == LIST_OR ? "||" : ";");
+        print_command(command->then);
+    }
+
+
+}
+
+/**
+ * Release allocated memory of a command
+ * @param  command [description]
+ * @return         [description]
+ */
+int free_command(struct command_t *command) {
+    for (int i = 0; i < command->arg_count; ++i)
+        free(command->args[i]);
+    free(command->args);
+    for (int i = 0; i < 3; ++i)
+        if (command->redirects[i])
+            free(command->redirects[i]);
+    if (command->heredoc > 0)
+        close(command->heredoc);
+    if (command->next) {
+        free_command(command->next);
+        command->next = NULL;
+    }
+    if (command->group)
+        free_command(command->group);
+    if (command->then)
+        free_command(command->then);
+    free(command->source);
+    free(command->name);
+    free(command);
+    return 0;
+}
+
+// for command substitution
+#define SUBST_MARKER '\x01'                     // stands in for a $(...) in the parsed line
+#define CAPTURE_CHUNK_MIN 4096
+#define CAPTURE_CHUNK_MAX (256 * 1024)
+#define CAPTURE_MEMFD_THRESHOLD (1024 * 1024)   // bigger outputs are spliced into a memfd
+
+struct capture_chunk {
+    struct capture_chunk *next;
+    size_t len, size;
+    char data[];
+};
+
+struct capture {
+    struct capture_chunk *head;
+    int memfd;
+    char *map;      // mmap of memfd, if the output was spilled
+    size_t map_len;
+};
+
+static struct capture *substitutions;
+static int substitution_count, substitution_next;
+
+/**
+ * Move the rest of a pipe into a memfd, without copying through userspace when possible
+ * @param  in_fd read end of the pipe
+ * @param  cap   capture whose chunks are flushed to the memfd first
+ * @return       0 on success, -1 on error
+ */
+static int capture_spill(int in_fd, struct capture *cap) {
+    cap->memfd = memfd_create("shellgibi-subst", MFD_CLOEXEC);
+    if (cap->memfd == -1)
+        return -1;
+
+    size_t total = 0;
+    struct capture_chunk *ch = cap->head;
+    while (ch) {
+        struct capture_chunk *next = ch->next;
+        if (write(cap->memfd, ch->data, ch->len) != (ssize_t) ch->len)
+            return -1;
+        total += ch->len;
+        free(ch);
+        ch = next;
+    }
+    cap->head = NULL;
+
+    bool can_splice = true;
+    char buf[65536];
+    while (1) {
+        ssize_t n;
+        if (can_splice) {
+            n = splice(in_fd, NULL, cap->memfd, NULL, CAPTURE_MEMFD_THRESHOLD, SPLICE_F_MOVE);
+            if (n == -1 && errno == EINVAL) { // kernel can't splice here, copy instead
+                can_splice = false;
+                continue;
+            }
+        } else {
+            n = read(in_fd, buf, sizeof(buf));
+            if (n > 0 && write(cap->memfd, buf, n) != n)
+                return -1;
+        }
+        if (n == -1 && errno == EINTR) continue;
+        if (n <= 0) {
+            if (n == -1) return -1;
+            break;
+        }
+        total += n;
+    }
+
+    cap->map_len = total;
+    if (total > 0) {
+        cap->map = mmap(NULL, total, PROT_READ, MAP_PRIVATE, cap->memfd, 0);
+        if (cap->map == MAP_FAILED) {
+            cap->map = NULL;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Read everything from a pipe into a list of chunks. Chunks double in size
+ * so nothing is ever realloc'd or copied twice.
+ * @param  in_fd read end of the pipe
+ * @param  cap   [description]
+ * @return       0 on success, -1 on error
+ */
+static int capture_read(int in_fd, struct capture *cap) {
+    struct capture_chunk **tail = &cap->head;
+    struct capture_chunk *ch = NULL;
+    size_t size = CAPTURE_CHUNK_MIN, total = 0;
+
+    while (1) {
+        if (ch == NULL || ch->len == ch->size) {
+            if (total >= CAPTURE_MEMFD_THRESHOLD)
+                return capture_spill(in_fd, cap);
+            ch = malloc(sizeof(struct capture_chunk) + size);
+            ch->next = NULL;
+            ch->len = 0;
+            ch->size = size;
+            *tail = ch;
+            tail = &ch->next;
+            if (size < CAPTURE_CHUNK_MAX) size *= 2;
+        }
+        ssize_t n = read(in_fd, ch->data + ch->len, ch->size - ch->len);
+        if (n == -1 && errno == EINTR) continue;
+        if (n == -1) return -1;
+        if (n == 0) break;
+        ch->len += n;
+        total += n;
+    }
+
+    // trailing newlines are dropped
+    struct capture_chunk *last = NULL;
+    size_t last_len = 0;
+    for (ch = cap->head; ch; ch = ch->next) {
+        size_t n = ch->len;
+        while (n > 0 && ch->data[n - 1] == '\n') n--;
+        if (n > 0) {
+            last = ch;
+            last_len = n;
+        }
+    }
+    ch = last ? last->next : cap->head;
+    if (last) {
+        last->len = last_len;
+        last->next = NULL;
+    } else
+        cap->head = NULL;
+    while (ch) {
+        struct capture_chunk *next = ch->next;
+        free(ch);
+        ch = next;
+    }
+    return 0;
+}
+
+static void capture_free(struct capture *cap) {
+    while (cap->head) {
+        struct capture_chunk *next = cap->head->next;
+        free(cap->head);
+        cap->head = next;
+    }
+    if (cap->map)
+        munmap(cap->map, cap->map_len);
+    if (cap->memfd != -1)
+        close(cap->memfd);
+    cap->map = NULL;
+    cap->memfd = -1;
+}
+
+/**
+ * Run a command line in a child with stdout going to a pipe and capture its output
+ * @param  line the text between $( and )
+ * @param  cap  [description]
+ * @return      0 on success, -1 on error
+ */
+static int capture_command(const char *line, struct capture *cap) {
+    int fd[2];
+    memset(cap, 0, sizeof(struct capture));
+    cap->memfd = -1;
+    if (pipe(fd) == -1)
+        return -1;
+
+    fflush(stdout); // or the child would write our pending prompt into the capture
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fd[0]);
+        dup2(fd[1], STDOUT_FILENO);
+        close(fd[1]);
+
+        // the parent's substitutions are not ours
+        substitutions = NULL;
+        substitution_count = substitution_next = 0;
+
+        struct command_t *c = calloc(1, sizeof(struct command_t));
+        char *copy = strdup(line);
+        parse_line(copy, c);
+        run_list(c);
+        fflush(stdout);
+        exit(last_status);
+    }
+    close(fd[1]);
+    int r = capture_read(fd[0], cap);
+    close(fd[0]);
+    waitpid(pid, NULL, 0);
+    return r;
+}
+
+/**
+ * Run every $(...) in buf and replace each with a SUBST_MARKER byte.
+ * The captured outputs are kept in substitutions[], in order of appearance.
+ * @param buf [description]
+ */
+static void extract_substitutions(char *buf) {
+    bool quoted = false;
+    for (char *p = buf; *p; p++) {
+        if (*p == '\'') quoted = !quoted;
+        if (quoted || p[0] != '$' || p[1] != '(')
+            continue;
+
+        int depth = 0;
+        char *end = p + 1;
+        for (; *end; end++) {
+            if (*end == '(') depth++;
+            if (*end == ')' && --depth == 0) break;
+        }
+        if (*end == 0) {
+            printf("-%s: unterminated $(\n", sysname);
+            return;
+        }
+
+        *end = 0;
+        substitutions = realloc(substitutions, sizeof(struct capture) * (substitution_count + 1));
+        if (capture_command(p + 2, &substitutions[substitution_count]) == -1)
+            printf("-%s: $(%s): %s\n", sysname, p + 2, strerror(errno));
+        substitution_count++;
+
+        *p = SUBST_MARKER;
+        memmove(p + 1, end + 1, strlen(end + 1) + 1);
+    }
+}
+
+static void free_substitutions() {
+    for (int i = 0; i < substitution_count; i++)
+        capture_free(&substitutions[i]);
+    free(substitutions);
+    substitutions = NULL;
+    substitution_count = substitution_next = 0;
+}
+
+/**
+ * Append an argument to a command being parsed, growing args geometrically
+ */
+static void push_arg(struct command_t *command, int *arg_index, int *arg_cap, char *arg) {
+    if (*arg_index + 1 >= *arg_cap) {
+        *arg_cap = *arg_cap ? *arg_cap * 2 : 8;
+        command->args = (char **) realloc(command->args, sizeof(char *) * *arg_cap);
+    }
+    command->args[(*arg_index)++] = arg;
+}
+
+static void append_arg(struct command_t *command, int *arg_index, int *arg_cap, const char *arg, size_t len) {
+    char *a = malloc(len + 1);
+    memcpy(a, arg, len);
+    a[len] = 0;
+    push_arg(command, arg_index, arg_cap, a);
+}
+
+// builds words that may span a literal prefix, several chunks and a literal suffix
+struct word_builder {
+    struct command_t *command;
+    int *arg_index, *arg_cap;
+    char *pending;
+    size_t len, size;
+    bool has_pending;
+};
+
+static void word_append(struct word_builder *wb, const char *s, size_t n) {
+    if (wb->len + n + 1 > wb->size) {
+        while (wb->len + n + 1 > wb->size)
+            wb->size = wb->size ? wb->size * 2 : 64;
+        wb->pending = realloc(wb->pending, wb->size);
+    }
+    memcpy(wb->pending + wb->len, s, n);
+    wb->len += n;
+    wb->has_pending = true;
+}
+
+static void word_break(struct word_builder *wb) {
+    if (wb->has_pending)
+        append_arg(wb->command, wb->arg_index, wb->arg_cap, wb->pending, wb->len);
+    wb->len = 0;
+    wb->has_pending = false;
+}
+
+/** split captured bytes at whitespace into words */
+static void word_split(struct word_builder *wb, const char *s, size_t n) {
+    size_t i = 0;
+    while (i < n) {
+        if (s[i] == ' ' || s[i] == '\t' || s[i] == '\n') {
+            word_break(wb);
+            i++;
+            continue;
+        }
+        size_t start = i;
+        while (i < n && s[i] != ' ' && s[i] != '\t' && s[i] != '\n') i++;
+        if (!wb->has_pending && i < n) // whole word in one piece, no need to stage it
+            append_arg(wb->command, wb->arg_index, wb->arg_cap, s + start, i - start);
+        else
+            word_append(wb, s + start, i - start);
+    }
+}
+
+/** add captured output to the word being built, split into words outside double quotes */
+static void word_add_capture(struct word_builder *wb, const char *s, size_t n, bool quoted) {
+    if (quoted)
+        word_append(wb, s, n);
+    else
+        word_split(wb, s, n);
+}
+
+/**
+ * Expand an argument containing SUBST_MARKERs into the words of the captured outputs.
+ * A substitution in double quotes is not split, and the quotes go.
+ */
+static void expand_substitutions(struct command_t *command, int *arg_index, int *arg_cap, const char *arg) {
+    struct word_builder wb = {command, arg_index, arg_cap, NULL, 0, 0, false};
+    bool quoted = false;
+    const char *p = arg;
+    while (*p) {
+        size_t n = strcspn(p, "\"\x01");
+        if (n > 0)
+            word_append(&wb, p, n);
+        p += n;
+        if (*p == '"') {
+            quoted = !quoted;
+            wb.has_pending = true; // "$(true)" is still an argument, if an empty one
+            p++;
+            continue;
+        }
+        if (*p == 0)
+            break;
+        p++;
+
+        if (substitution_next >= substitution_count)
+            continue;
+        struct capture *cap = &substitutions[substitution_next++];
+        if (cap->map) {
+            size_t len = cap->map_len;
+            while (len > 0 && cap->map[len - 1] == '\n') len--; // trailing newlines are dropped
+            word_add_capture(&wb, cap->map, len, quoted);
+        }
+        for (struct capture_chunk *ch = cap->head; ch; ch = ch->next)
+            word_add_capture(&wb, ch->data, ch->len, quoted);
+    }
+    word_break(&wb);
+    free(wb.pending);
+}
+
+// for here-documents and here-strings
+
+/**
+ * Put data into a sealed memfd, positioned at the start, to be used as stdin
+ * @return the memfd, or -1 on error
+ */
+static int make_input_memfd(const char *data, size_t len) {
+    int fd = memfd_create("shellgibi-heredoc", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd == -1)
+        return -1;
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = write(fd, data + done, len - done);
+        if (n == -1 && errno == EINTR) continue;
+        if (n == -1) {
+            close(fd);
+            return -1;
+        }
+        done += n;
+    }
+    fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL);
+    lseek(fd, 0, SEEK_SET);
+    return fd;
+}
+
+/**
+ * Read here-document lines from the terminal until the delimiter
+ * @param  delim      [description]
+ * @param  strip_tabs <<- strips leading tabs from every line
+ * @return            memfd with the body, or -1 on error
+ */
+static int read_heredoc(const char *delim, bool strip_tabs) {
+    char *body = NULL, *line = NULL;
+    size_t len = 0, size = 0, line_cap = 0;
+    ssize_t n;
+
+    while (1) {
+        printf("> ");
+        fflush(stdout);
+        if ((n = getline(&line, &line_cap, stdin)) == -1) {
+            printf("\n-%s: warning: here-document delimited by end-of-file (wanted `%s')\n", sysname, delim);
+            break;
+        }
+        char *p = line;
+        if (strip_tabs)
+            while (*p == '\t') p++, n--;
+        if (n > 0 && p[n - 1] == '\n' && (size_t) (n - 1) == strlen(delim) && strncmp(p, delim, n - 1) == 0)
+            break;
+        if (len + n > size) { // grow geometrically so big bodies are not copied over and over
+            while (len + n > size)
+                size = size ? size * 2 : 4096;
+            body = realloc(body, size);
+        }
+        memcpy(body + len, p, n);
+        len += n;
+    }
+    free(line);
+    int fd = make_input_memfd(body, len);
+    free(body);
+    return fd;
+}
+
+/**
+ * Parse a command string into a command struct
+ * @param  buf     [description]
+ * @param  command [description]
+ * @return         0, -1 on a syntax error (command is then left empty)
+ */
+int parse_command(char *buf, struct command_t *command) {
+    const char *splitters = " \t"; // split at whitespace
+    int index, len;
+    static int depth = 0; // pipes parse recursively, substitutions live until the outermost call is done
+    depth++;
+    extract_substitutions(buf);
+    len = strlen(buf);
+    while (len > 0 && strchr(splitters, buf[0]) != NULL) // trim left whitespace
+    {
+        buf++;
+        len--;
+    }
+    while (len > 0 && strchr(splitters, buf[len - 1]) != NULL)
+        buf[--len] = 0; // trim right whitespace
+
+    if (len > 0 && buf[len - 1] == '?') // auto-complete
+        command->auto_complete = true;
+    if (len > 0 && buf[len - 1] == '&') // background
+        command->background = true;
+
+    char *pch = strtok(buf, splitters);
+    command->args = NULL;
+    char *leading = NULL; // <in >out with no command, the first word is a redirect
+    if (pch != NULL && (pch[0] == '>' || (pch[0] == '<' && pch[1] != '<'))) {
+        leading = pch;
+        pch = NULL;
+    }
+
+    int redirect_index;
+    int arg_index = 0, arg_cap = 0;
+    bool bad = false; // a syntax error, nothing of the command runs
+    if (pch != NULL && strchr(pch, SUBST_MARKER)) { // name comes from a substitution
+        expand_substitutions(command, &arg_index, &arg_cap, pch);
+        if (arg_index > 0) {
+            command->name = command->args[0];
+            memmove(command->args, command->args + 1, sizeof(char *) * --arg_index);
+        } else
+            command->name = calloc(1, 1);
+    } else {
+        command->name = (char *) malloc(pch ? strlen(pch) + 1 : 1);
+        if (pch == NULL)
+            command->name[0] = 0;
+        else
+            strcpy(command->name, pch);
+    }
+    if (command->args == NULL)
+        command->args = (char **) malloc(sizeof(char *));
+
+    char temp_buf[1024], *arg;
+    while (1) {
+        // tokenize input on splitters
+        pch = leading ? leading : strtok(NULL, splitters);
+        leading = NULL;
+        if (!pch) break;
+        arg = temp_buf;
+        strcpy(arg, pch);
+        len = strlen(arg);
+
+        if (len == 0) continue; // empty arg, go for next
+        while (len > 0 && strchr(splitters, arg[0]) != NULL) // trim left whitespace
+        {
+            arg++;
+            len--;
+        }
+        while (len > 0 && strchr(splitters, arg[len - 1]) != NULL) arg[--len] = 0; // trim right whitespace
+        if (len == 0) continue; // empty arg, go for next
+
+        // piping to another command
+        if (strcmp(arg, "|") == 0) {
+            struct command_t *c = calloc(1, sizeof(struct command_t));
+            int l = strlen(pch);
+            pch[l] = splitters[0]; // restore strtok termination
+            index = 1;
+            while (pch[index] == ' ' || pch[index] == '\t') index++; // skip whitespaces
+
+            if (parse_command(pch + index, c) == -1)
+                bad = true;
+            pch[l] = 0; // put back strtok termination
+            command->next = c;
+            continue;
+        }
+
+        // background process
+        if (strcmp(arg, "&") == 0)
+            continue; // handled before
+
+        // here-strings and here-documents
+        if (strcmp(arg, "<<") == 0 || strcmp(arg, "<<-") == 0 || strcmp(arg, "<<<") == 0) { // << EOF, <<< word
+            if ((pch = strtok(NULL, splitters)) == NULL || strcmp(pch, "|") == 0) { // cat <<< | wc
+                printf("-%s: syntax error near `%s'\n", sysname, pch ? pch : arg);
+                bad = true;
+                break;
+            }
+            snprintf(arg + len, sizeof(temp_buf) - (arg - temp_buf) - len - 1, "%s", pch); // room for the \n
+            len = strlen(arg);
+        }
+        if (len > 3 && strncmp(arg, "<<<", 3) == 0) {
+            arg += 3;
+            len -= 3;
+            if (len > 2 && (arg[0] == '"' || arg[0] == '\'') && arg[len - 1] == arg[0]) {
+                arg[--len] = 0;
+                arg++;
+                len--;
+            }
+            arg[len++] = '\n'; // like a here-document, a here-string ends in a newline
+            if (command->heredoc > 0)
+                close(command->heredoc);
+            command->heredoc = make_input_memfd(arg, len);
+            continue;
+        }
+        if (len > 2 && strncmp(arg, "<<", 2) == 0) {
+            bool strip_tabs = arg[2] == '-';
+            arg += strip_tabs ? 3 : 2;
+            len -= strip_tabs ? 3 : 2;
+            if (len > 2 && (arg[0] == '"' || arg[0] == '\'') && arg[len - 1] == arg[0]) {
+                arg[--len] = 0;
+                arg++;
+            }
+            if (command->heredoc > 0)
+                close(command->heredoc);
+            command->heredoc = read_heredoc(arg, strip_tabs);
+            continue;
+        }
+
+        // handle input redirection
+        redirect_index = -1;
+        if (arg[0] == '<')
+            redirect_index = 0;
+        if (arg[0] == '>') {
+            if (len > 1 && arg[1] == '>') {
+                redirect_index = 2;
+                arg++;
+                len--;
+            } else redirect_index = 1;
+        }
+        if (redirect_index != -1) {
+            char *target = arg + 1;
+            if (*target == 0 && (pch = strtok(NULL, splitters)) != NULL) // > file
+                target = pch;
+            free(command->redirects[redirect_index]); // the last one wins
+            command->redirects[redirect_index] = strdup(target);
+            continue;
+        }
+
+        // command substitution
+        if (strchr(arg, SUBST_MARKER)) {
+            expand_substitutions(command, &arg_index, &arg_cap, arg);
+            continue;
+        }
+
+        // normal arguments
+        if (len > 2 && ((arg[0] == '"' && arg[len - 1] == '"')
+                        || (arg[0] == '\'' && arg[len - 1] == '\''))) // quote wrapped arg
+        {
+            arg[--len] = 0;
+            arg++;
+        } else if (has_glob(arg)) { // a pattern with no matches stays as it is, like in bash
+            int count;
+            char **paths = glob_expand(arg, &count);
+            for (int i = 0; i < count; i++)
+                push_arg(command, &arg_index, &arg_cap, paths[i]);
+            free(paths);
+            if (count > 0)
+                continue;
+        }
+        append_arg(command, &arg_index, &arg_cap, arg, len);
+    }
+    if (bad) {
+        for (int i = 0; i < arg_index; i++)
+            free(command->args[i]);
+        arg_index = 0;
+        command->name[0] = 0;
+        if (command->heredoc > 0)
+            close(command->heredoc);
+        command->heredoc = 0;
+        for (int i = 0; i < 3; i++) {
+            free(command->redirects[i]);
+            command->redirects[i] = NULL;
+        }
+        if (command->next) {
+            free_command(command->next);
+            command->next = NULL;
+        }
+    }
+    if (command->name[0] == 0 && arg_index > 0) { // >out echo hi: the command is the first word after the redirects
+        free(command->name);
+        command->name = command->args[0];
+        memmove(command->args, command->args + 1, sizeof(char *) * --arg_index);
+    }
+    command->arg_count = arg_index;
+    if (--depth == 0)
+        free_substitutions();
+    return bad ? -1 : 0;
+}
+
+// for command lists
+
+static void syntax_error(const char *near) {
+    if (*near == 0)
+        printf("-%s: syntax error: unexpected end of line\n", sysname);
+    else
+        printf("-%s: syntax error near `%.2s'\n", sysname, near);
+}
+
+static bool word_ends(char c) {
+    return c == 0 || c == ' ' || c == '\t' || c == ';' || c == '&' || c == '|';
+}
+
+/**
+ * Find where the pipeline starting at p ends: the first ; & && || outside quotes and $(...)
+ */
+static char *pipeline_end(char *p) {
+    char quote = 0;
+    int depth = 0;
+    for (; *p; p++) {
+        if (quote) {
+            if (*p == quote) quote = 0;
+            continue;
+        }
+        if (*p == '\'' || *p == '"') quote = *p;
+        else if (*p == '(') depth++;
+        else if (*p == ')' && depth > 0) depth--;
+        else if (depth == 0 && (*p == ';' || *p == '&' || (p[0] == '|' && p[1] == '|')))
+            break;
+    }
+    return p;
+}
+
+/**
+ * Parse pipelines and { } groups joined by ; & && || until the end of the line,
+ * or the closing } when in a group
+ * @param  pos      where to start, left after what was parsed
+ * @param  in_group [description]
+ * @param  list     set to the first command, NULL if there were none
+ * @return          0, -1 on a syntax error
+ */
+static int parse_list(char **pos, bool in_group, struct command_t **list) {
+    struct command_t **tail = list;
+    struct command_t *last = NULL;
+    char *p = *pos;
+    *list = NULL;
+    while (1) {
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p == 0) {
+            if (in_group || (last && last->op != LIST_SEQ)) {
+                syntax_error(p);
+                return -1;
+            }
+            break;
+        }
+        if (in_group && p[0] == '}' && word_ends(p[1])) {
+            if (last == NULL || last->op != LIST_SEQ) { // bash wants `{ cmd; }'
+                syntax_error(p);
+                return -1;
+            }
+            p++;
+            break;
+        }
+        if (*p == ';' || *p == '&' || *p == '|') { // an operator with no command before it
+            syntax_error(p);
+            return -1;
+        }
+
+        struct command_t *c = calloc(1, sizeof(struct command_t));
+        *tail = c;
+        tail = &c->then;
+        last = c;
+        if (p[0] == '{' && word_ends(p[1])) {
+            p++;
+            c->name = strdup("{");
+            c->args = malloc(sizeof(char *));
+            if (parse_list(&p, true, &c->group) == -1)
+                return -1;
+            while (*p == ' ' || *p == '\t') p++;
+            if (*p != 0 && *p != ';' && *p != '&' && *p != '|' && !(in_group && *p == '}')) {
+                syntax_error(p); // redirects and pipes of whole groups are not supported
+                return -1;
+            }
+            c->background = p[0] == '&' && p[1] != '&';
+        } else {
+            // kept as text until it runs, so $(...) and globs see what the commands before it did
+            char *end = pipeline_end(p);
+            bool background = end[0] == '&' && end[1] != '&';
+            if (background) // keep the & in, parse_command makes it a background job
+                end++;
+            c->source = strndup(p, end - p);
+            c->background = background;
+            p = end;
+            if (background)
+                continue;
+        }
+
+        if (p[0] == '&' && p[1] == '&') {
+            c->op = LIST_AND;
+            p += 2;
+        } else if (p[0] == '|' && p[1] == '|') {
+            c->op = LIST_OR;
+            p += 2;
+        } else if (*p == ';' || *p == '&') {
+            c->op = LIST_SEQ;
+            p++;
+        } else if (*p == '|') {
+            syntax_error(p);
+            return -1;
+        }
+    }
+    *pos = p;
+    return 0;
+}
+
+/**
+ * Parse a list entry right before it runs: expand its $(...) and globs, read its here-documents
+ * @param command [description]
+ */
+int parse_entry(struct command_t *command) {
+    if (command->source == NULL)
+        return 0;
+    char *buf = command->source;
+    command->source = NULL;
+    command->background = false;
+    int r = parse_command(buf, command);
+    free(buf);
+    return r;
+}
+
+/**
+ * A list entry that && or || skips still has its here-document bodies coming on stdin, read them past.
+ * Nothing else of it is expanded, so its $(...) don't run.
+ * @param command [description]
+ */
+void skip_entry(struct command_t *command) {
+    for (struct command_t *c = command->group; c; c = c->then)
+        skip_entry(c);
+    if (command->source == NULL)
+        return;
+    char *save;
+    for (char *w = strtok_r(command->source, " \t", &save); w; w = strtok_r(NULL, " \t", &save)) {
+        if (strncmp(w, "<<", 2) != 0 || w[2] == '<')
+            continue;
+        bool strip_tabs = w[2] == '-';
+        char *delim = w + (strip_tabs ? 3 : 2);
+        if (*delim == 0 && (delim = strtok_r(NULL, " \t", &save)) == NULL)
+            break;
+        size_t len = strlen(delim);
+        if (len > 2 && (delim[0] == '"' || delim[0] == '\'') && delim[len - 1] == delim[0]) {
+            delim[len - 1] = 0;
+            delim++;
+        }
+        int fd = read_heredoc(delim, strip_tabs);
+        if (fd != -1)
+            close(fd);
+    }
+    free(command->source);
+    command->source = NULL;
+}
+
+/**
+ * Parse a whole prompt line into a list of pipelines and { } groups, so it can run in one go
+ * @param  buf     [description]
+ * @param  command first command of the list
+ * @return         0, -1 on a syntax error (command is then left empty)
+ */
+int parse_line(char *buf, struct command_t *command) {
+    struct command_t *list;
+    char *p = buf;
+    int r = parse_list(&p, false, &list);
+    if (r == -1 || list == NULL) {
+        if (list)
+            free_command(list);
+        command->name = calloc(1, 1);
+        command->args = malloc(sizeof(char *));
+        return r;
+    }
+    *command = *list; // the first command lives in the caller's struct
+    free(list);
+    return 0;
+}
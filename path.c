@@ -0,0 +1,54 @@
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "shellgibi.h"
+
+char *PATH;
+char *USER;
+
+/**
+ * Find a command in PATH. Names with a slash are taken as they are, for exec to say what is wrong with them.
+ * @param  name [description]
+ * @return      malloc'd full path, or NULL if there is no such file or it isn't executable
+ */
+char *resolve_command(const char *name) {
+    if (strchr(name, '/'))
+        return access(name, F_OK) != -1 ? strdup(name) : NULL;
+
+    char *pathCopy = malloc(strlen(PATH) + 1);
+    strcpy(pathCopy, PATH);
+    char *token = strtok(pathCopy, ":");
+
+
+    // loop through the string to extract all other tokens
+    while (token != NULL) {
+        //printf( " %s\n", token ); //printing each token
+        char *dir = malloc(strlen(token) + 1 + strlen(name) + 1);
+        strcpy(dir, token);
+        strcat(dir, "/");
+        strcat(dir, name);
+        //printf( " %s\n", dir );
+        if (access(dir, X_OK) != -1) { // a file that can't run doesn't hide one later in PATH
+            free(pathCopy);
+            return dir;
+        }
+        free(dir);
+        token = strtok(NULL, ":");
+
+    }
+    free(pathCopy);
+    return NULL;
+}
+
+void setArgsForExecv(struct command_t *command, char *path) {
+    command->args[0] = path ? path : strdup(command->name);
+
+    // set args[arg_count-1] (last) to NULL
+    command->args[command->arg_count - 1] = NULL;
+
+}
+
+bool prefix(const char *pre, const char *str) {
+    return strncmp(pre, str, strlen(pre)) == 0;
+}
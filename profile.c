@@ -0,0 +1,255 @@
+#include <unistd.h>
+#include <sys/timerfd.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+
+#include "shellgibi.h"
+
+// for profile
+#define PROFILE_DEFAULT_INTERVAL_MS 100
+#define PROFILE_TIMELINE_ROWS 20 // longer runs are bucketed down to this many rows
+
+struct profile_sample {
+    double t;                   // seconds since start
+    double cpu;                 // percent of one cpu since the previous sample
+    long rss;                   // KB
+    long long read_bytes, write_bytes;
+    int procs;
+};
+
+struct profile_tick {
+    unsigned long long cpu_ticks;
+    long rss_pages;
+    long long read_bytes, write_bytes;
+    int procs;
+};
+
+static ssize_t read_small_file(const char *path, char *buf, size_t size) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return -1;
+    ssize_t n = read(fd, buf, size - 1);
+    close(fd);
+    if (n >= 0)
+        buf[n] = 0;
+    return n;
+}
+
+/**
+ * Add one process and, through /proc/<pid>/task/<tid>/children, all its descendants to a tick
+ */
+static void profile_sample_tree(pid_t pid, struct profile_tick *tick) {
+    char path[64], buf[1024];
+
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+    if (read_small_file(path, buf, sizeof(buf)) <= 0)
+        return; // already gone
+    char *p = strrchr(buf, ')'); // comm may contain spaces
+    unsigned long long utime = 0, stime = 0;
+    if (p == NULL || sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu", &utime, &stime) != 2)
+        return;
+    tick->cpu_ticks += utime + stime;
+    tick->procs++;
+
+    snprintf(path, sizeof(path), "/proc/%d/statm", pid);
+    long size, resident;
+    if (read_small_file(path, buf, sizeof(buf)) > 0 && sscanf(buf, "%ld %ld", &size, &resident) == 2)
+        tick->rss_pages += resident;
+
+    snprintf(path, sizeof(path), "/proc/%d/io", pid);
+    if (read_small_file(path, buf, sizeof(buf)) > 0) {
+        char *r = strstr(buf, "\nread_bytes: "), *w = strstr(buf, "\nwrite_bytes: ");
+        if (r) tick->read_bytes += atoll(r + 13);
+        if (w) tick->write_bytes += atoll(w + 14);
+    }
+
+    snprintf(path, sizeof(path), "/proc/%d/task", pid);
+    DIR *tasks = opendir(path);
+    if (tasks == NULL)
+        return;
+    struct dirent *de;
+    while ((de = readdir(tasks)) != NULL) {
+        if (de->d_name[0] == '.')
+            continue;
+        char children_path[300];
+        snprintf(children_path, sizeof(children_path), "/proc/%d/task/%s/children", pid, de->d_name);
+        if (read_small_file(children_path, buf, sizeof(buf)) <= 0)
+            continue;
+        for (char *tok = strtok_r(buf, " \n", &p); tok; tok = strtok_r(NULL, " \n", &p))
+            profile_sample_tree(atoi(tok), tick);
+    }
+    closedir(tasks);
+}
+
+static void print_profile(struct profile_sample *samples, int n, double wall) {
+    struct profile_sample peak = {0};
+    for (int i = 0; i < n; i++) {
+        if (samples[i].cpu > peak.cpu) peak.cpu = samples[i].cpu;
+        if (samples[i].rss > peak.rss) peak.rss = samples[i].rss;
+        if (samples[i].procs > peak.procs) peak.procs = samples[i].procs;
+        if (samples[i].read_bytes > peak.read_bytes) peak.read_bytes = samples[i].read_bytes;
+        if (samples[i].write_bytes > peak.write_bytes) peak.write_bytes = samples[i].write_bytes;
+    }
+
+    printf("%8s %7s %10s %8s %10s %10s\n", "time", "cpu%", "rss KB", "procs", "read KB", "write KB");
+    int per_row = (n + PROFILE_TIMELINE_ROWS - 1) / PROFILE_TIMELINE_ROWS;
+    if (per_row < 1) per_row = 1;
+    for (int i = 0; i < n; i += per_row) {
+        struct profile_sample row = samples[i]; // peak within the bucket
+        double cpu_sum = 0;
+        int j;
+        for (j = i; j < n && j < i + per_row; j++) {
+            cpu_sum += samples[j].cpu;
+            if (samples[j].rss > row.rss) row.rss = samples[j].rss;
+            if (samples[j].procs > row.procs) row.procs = samples[j].procs;
+            row.read_bytes = samples[j].read_bytes;
+            row.write_bytes = samples[j].write_bytes;
+        }
+        printf("%7.2fs %7.1f %10ld %8d %10lld %10lld\n", samples[j - 1].t, cpu_sum / (j - i), row.rss,
+               row.procs, row.read_bytes / 1024, row.write_bytes / 1024);
+    }
+    printf("peak: %.1f%% cpu, %ld KB rss, %d procs; total %lld KB read, %lld KB written in %.2fs\n",
+           peak.cpu, peak.rss, peak.procs, peak.read_bytes / 1024, peak.write_bytes / 1024, wall);
+}
+
+static void write_profile_csv(const char *filename, struct profile_sample *samples, int n) {
+    FILE *fp = fopen(filename, "w");
+    if (!fp) {
+        printf("-%s: profile: %s: %s\n", sysname, filename, strerror(errno));
+        return;
+    }
+    fprintf(fp, "time_s,cpu_percent,rss_kb,procs,read_bytes,write_bytes\n");
+    for (int i = 0; i < n; i++)
+        fprintf(fp, "%.3f,%.1f,%ld,%d,%lld,%lld\n", samples[i].t, samples[i].cpu, samples[i].rss,
+                samples[i].procs, samples[i].read_bytes, samples[i].write_bytes);
+    fclose(fp);
+}
+
+/**
+ * profile [-i ms] [-o file.csv] cmd args...: run a command and sample cpu, rss and io
+ * of its whole process tree at a fixed interval
+ */
+int profile(struct command_t *command, int in_fd) {
+    int interval_ms = PROFILE_DEFAULT_INTERVAL_MS;
+    char *csv = NULL;
+    int first = 0;
+    while (first + 1 < command->arg_count && command->args[first][0] == '-') {
+        if (strcmp(command->args[first], "-i") == 0)
+            interval_ms = atoi(command->args[first + 1]);
+        else if (strcmp(command->args[first], "-o") == 0)
+            csv = command->args[first + 1];
+        else
+            break;
+        first += 2;
+    }
+    if (first >= command->arg_count || interval_ms <= 0) {
+        printf("usage: profile [-i ms] [-o file.csv] cmd args...\n");
+        return SUCCESS;
+    }
+
+    // the profiled command, sharing the strings of ours
+    struct command_t sub = *command;
+    sub.name = command->args[first];
+    sub.args = malloc(sizeof(char *) * (command->arg_count - first));
+    sub.arg_count = command->arg_count - first - 1;
+    for (int i = 0; i < sub.arg_count; i++)
+        sub.args[i] = command->args[first + 1 + i];
+    sub.background = false;
+
+    int tfd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (tfd == -1) {
+        printf("-%s: profile: %s\n", sysname, strerror(errno));
+        free(sub.args);
+        return SUCCESS;
+    }
+
+    struct rusage self_start, self_end;
+    int64_t start = monotonic_ns();
+    fflush(stdout);
+    pid_t pid = launch_command(&sub, in_fd);
+    free(sub.args);
+    if (pid == -1) {
+        close(tfd);
+        return UNKNOWN;
+    }
+    getrusage(RUSAGE_SELF, &self_start);
+
+    struct itimerspec its = {0};
+    its.it_interval.tv_sec = interval_ms / 1000;
+    its.it_interval.tv_nsec = (interval_ms % 1000) * 1000000L;
+    its.it_value = its.it_interval;
+    timerfd_settime(tfd, 0, &its, NULL);
+
+    // a pidfd lets us notice the exit right away instead of at the next tick
+    int pidfd = syscall(SYS_pidfd_open, pid, 0);
+    struct pollfd fds[2] = {{tfd, POLLIN, 0}, {pidfd, POLLIN, 0}};
+
+    long page_kb = sysconf(_SC_PAGESIZE) / 1024;
+    double hz = sysconf(_SC_CLK_TCK);
+    int n = 0, cap = 64;
+    struct profile_sample *samples = malloc(sizeof(struct profile_sample) * cap);
+    unsigned long long last_ticks = 0;
+    double last_t = 0;
+
+    while (1) {
+        if (poll(fds, pidfd == -1 ? 1 : 2, -1) == -1 && errno != EINTR)
+            break;
+        if (pidfd != -1 && (fds[1].revents & POLLIN))
+            break;
+        uint64_t expirations;
+        if (read(tfd, &expirations, sizeof(expirations)) != sizeof(expirations))
+            continue;
+
+        // without a pidfd this is how we notice the exit: a zombie still has a stat to read, so ask waitid,
+        // leaving it for wait_job to reap with its rusage
+        siginfo_t info = {0};
+        if (waitid(P_PID, pid, &info, WEXITED | WNOHANG | WNOWAIT) == 0 && info.si_pid == pid)
+            break;
+
+        struct profile_tick tick = {0};
+        profile_sample_tree(pid, &tick);
+        if (tick.procs == 0)
+            break;
+
+        double t = (monotonic_ns() - start) / 1e9;
+        if (n == cap) {
+            cap *= 2;
+            samples = realloc(samples, sizeof(struct profile_sample) * cap);
+        }
+        struct profile_sample *s = &samples[n++];
+        s->t = t;
+        s->cpu = tick.cpu_ticks > last_ticks ? (tick.cpu_ticks - last_ticks) / hz / (t - last_t) * 100 : 0;
+        s->rss = tick.rss_pages * page_kb;
+        s->read_bytes = tick.read_bytes;
+        s->write_bytes = tick.write_bytes;
+        s->procs = tick.procs;
+        last_ticks = tick.cpu_ticks;
+        last_t = t;
+    }
+
+    getrusage(RUSAGE_SELF, &self_end);
+    last_status = exit_status(wait_job(pid));
+    double wall = (monotonic_ns() - start) / 1e9;
+    double overhead = timeval_seconds(self_end.ru_utime) - timeval_seconds(self_start.ru_utime)
+                      + timeval_seconds(self_end.ru_stime) - timeval_seconds(self_start.ru_stime);
+
+    print_profile(samples, n, wall);
+    printf("%d samples every %dms, sampling used %.2f%% cpu\n", n, interval_ms,
+           wall > 0 ? overhead / wall * 100 : 0);
+    if (csv)
+        write_profile_csv(csv, samples, n);
+
+    free(samples);
+    close(tfd);
+    if (pidfd != -1)
+        close(pidfd);
+    return SUCCESS;
+}
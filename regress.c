@@ -0,0 +1,96 @@
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "shellgibi.h"
+
+// regression test: command lines whose output and status once came out wrong
+#define REGRESS_OUT_MAX 4096
+
+struct regress_case {
+    const char *line;
+    const char *out;            // all of stdout, or how it starts if prefix is set
+    bool prefix;
+    int status;                 // last_status after the line
+};
+
+static const struct regress_case cases[] = {
+    // a builtin in the middle of a pipeline feeds the stages after it
+    {"seq 1 5 | xargs echo | wc -l", "1\n", false, 0},
+    {"xargs echo <<<abc | tr a-z A-Z", "ABC\n", false, 0},
+    {"seq 1 3 | xargs -n 1 echo | tr 0-9 a-z", "b\nc\nd\n", false, 0},
+    {"xargs echo <<<abc | false", "", false, 1},
+    // a syntax error stops the rest of the line
+    {"cat << && echo yes", "-shellgibi: syntax error near `<<'\n", false, 2},
+    {"cat <<< | wc -c; echo yes", "-shellgibi: syntax error near `|'\n", false, 2},
+    {"{ cat <<-; echo no; } || echo yes", "-shellgibi: syntax error near `<<-'\n", false, 2},
+    {"every -n 1 1ms echo tick | tr a-z A-Z", "TICK\n\nevery 1ms: 1 runs", true, 0},
+};
+
+static char root[] = "/tmp/shellgibi-regress-XXXXXX";
+
+/** run a line like the prompt does, with everything it printed flushed */
+static void run_line(const char *line) {
+    char buf[4096];
+    struct command_t *command = calloc(1, sizeof(struct command_t));
+    snprintf(buf, sizeof(buf), "%s", line);
+    if (parse_line(buf, command) == -1)
+        last_status = 2;
+    else
+        run_list(command);
+    free_command(command);
+    fflush(stdout);
+    reap_background_jobs();
+}
+
+int main() {
+    if (mkdtemp(root) == NULL) {
+        perror(root);
+        return 2;
+    }
+    chdir(root);
+    PATH = getenv("PATH");
+    USER = getenv("USER");
+
+    // what the lines print goes to a file to compare, errors go nowhere, the report goes to the real stderr
+    int report_fd = dup(STDERR_FILENO);
+    int out_fd = open("out", O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    int null_fd = open("/dev/null", O_WRONLY);
+    dup2(out_fd, STDOUT_FILENO);
+    dup2(null_fd, STDERR_FILENO);
+    close(null_fd);
+    FILE *report = fdopen(report_fd, "w");
+    setvbuf(report, NULL, _IONBF, 0); // or the children of the lines would write it out again
+
+    int failed = 0, count = sizeof(cases) / sizeof(cases[0]);
+    for (int i = 0; i < count; i++) {
+        ftruncate(out_fd, 0);
+        lseek(out_fd, 0, SEEK_SET);
+        last_status = 0;
+        run_line(cases[i].line);
+
+        char out[REGRESS_OUT_MAX];
+        ssize_t n = pread(out_fd, out, sizeof(out) - 1, 0);
+        out[n > 0 ? n : 0] = 0;
+        bool ok = cases[i].prefix ? strncmp(out, cases[i].out, strlen(cases[i].out)) == 0
+                                  : strcmp(out, cases[i].out) == 0;
+        ok &= last_status == cases[i].status;
+        if (!ok) {
+            fprintf(report, "FAIL: %s\n  expected status %d and output%s:\n%s  got status %d and:\n%s",
+                    cases[i].line, cases[i].status, cases[i].prefix ? " starting with" : "", cases[i].out,
+                    last_status, out);
+            failed++;
+        }
+    }
+    fprintf(report, "%d of %d regression cases passed\n", count - failed, count);
+    fclose(report);
+
+    close(out_fd);
+    unlink("out");
+    chdir("/");
+    rmdir(root);
+    return failed > 0;
+}
@@ -0,0 +1,167 @@
+#ifndef SHELLGIBI_H
+#define SHELLGIBI_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+extern const char *sysname;
+extern char *PATH;
+extern char *USER;
+extern const int MAX_MATCHES_AUTOCOMPLETE;
+#define NUMUSERMETHODS 13
+extern char *userMethods[NUMUSERMETHODS];
+
+enum return_codes {
+    SUCCESS = 0,
+    EXIT = 1,
+    UNKNOWN = 2,
+    SYNTAX_ERROR = 3, // the line can't run, none of the rest of it does
+};
+enum list_op {
+    LIST_SEQ = 0, // ; or & or the end of the line, the next command always runs
+    LIST_AND,     // &&, the next command runs if this one succeeded
+    LIST_OR,      // ||, the next command runs if this one failed
+};
+struct command_t {
+    char *name;
+    bool background;
+    bool auto_complete;
+    int arg_count;
+    char **args;
+    char *redirects[3]; // in/out redirection
+    int heredoc; // sealed memfd with a here-document/here-string for stdin, 0 if none
+    struct command_t *next; // for piping
+    struct command_t *group; // commands of a { } group, run instead of name and args
+    enum list_op op; // how the list goes on after this command
+    struct command_t *then; // next command of a ; && || list
+    char *source; // text of a pipeline in a list, parsed right before it runs, NULL once parsed
+};
+
+// parse.c
+void print_command(struct command_t *command);
+
+int free_command(struct command_t *command);
+
+int parse_command(char *buf, struct command_t *command);
+
+int parse_line(char *buf, struct command_t *command);
+
+int parse_entry(struct command_t *command);
+
+void skip_entry(struct command_t *command);
+
+// path.c
+char *resolve_command(const char *name);
+
+void setArgsForExecv(struct command_t *command, char *path);
+
+bool prefix(const char *pre, const char *str);
+
+// complete.c
+char *onematch(char *cmd);
+
+char **getListOfMatchingCommands(char *cmd);
+
+void freeListOfMatchingCommands(char **matches);
+
+void printArray(char **a);
+
+// cache.c
+int match_cached_commands(const char *prefix, const char **out, int max);
+
+// glob.c
+bool has_glob(const char *arg);
+
+char **glob_expand(const char *pattern, int *count);
+
+// copy.c
+bool copy_command(struct command_t *command, int in_fd);
+
+// exec.c
+extern int last_status;
+
+void exec_failed(const char *name);
+
+int exit_status(int status);
+
+int run_list(struct command_t *command);
+
+int process_command2(struct command_t *command, int in_fd);
+
+pid_t launch_command(struct command_t *command, int in_fd);
+
+pid_t launch_next(struct command_t *next, int *out_fd);
+
+// builtins.c
+char *numberedLine(int number, char **args, int count);
+
+int getCurrentLineNumber(char *filename);
+
+bool StartsWith(const char *a, const char *b);
+
+void deleteLineFromFile(char *filename, char *lineno);
+
+void printRandomline(char *filename);
+
+// suggest.c
+void expire_command_index();
+
+void refresh_command_index();
+
+int suggest_commands(const char *name, const char **out, int max);
+
+void command_not_found(const char *name);
+
+// jump.c
+void jump_visit(const char *dir);
+
+const char *jump_find(char **fragments, int count);
+
+int change_directory(const char *dir);
+
+int jump(struct command_t *command);
+
+// xargs.c
+int xargs(struct command_t *command, int in_fd);
+
+// every.c
+int every(struct command_t *command, int in_fd);
+
+// jobs.c
+double timeval_seconds(struct timeval tv);
+
+int64_t monotonic_ns();
+
+long long parse_size(const char *s);
+
+void job_started(pid_t pid, struct command_t *command);
+
+void job_limited(pid_t pid, const char *cgroup);
+
+void job_reaped(pid_t pid, int status, struct rusage *ru);
+
+int wait_job(pid_t pid);
+
+pid_t wait_any_job(int *status);
+
+void reap_background_jobs();
+
+void jobstats(struct command_t *command);
+
+// limit.c
+void cgroup_finish(const char *cgroup, long *oom_kills, long *throttled, double *throttled_sec);
+
+void limit_child();
+
+int limit(struct command_t *command, int in_fd);
+
+// meter.c
+int meter(struct command_t *command, int in_fd);
+
+// profile.c
+int profile(struct command_t *command, int in_fd);
+
+#endif
@@ -0,0 +1,144 @@
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "shellgibi.h"
+
+// soak test: a long session of mixed command lines and completions, its RSS has to stay flat
+#define SOAK_RUNS 1000000
+#define SOAK_WARMUP_DIVISOR 10 // the first tenth of the runs fills the caches and the jump database
+#define SOAK_FORK_EVERY 1000   // one line in this many starts processes, the rest run in the shell
+#ifdef SOAK_LEAK_CHECK
+#define SOAK_MAX_GROWTH_KB -1  // the sanitizer holds on to freed memory, LeakSanitizer does the checking at exit
+#else
+#define SOAK_MAX_GROWTH_KB 1024
+#endif
+
+static char root[] = "/tmp/shellgibi-soak-XXXXXX";
+
+// lines that the shell runs itself: builtins, lists, groups, globs, the copy fast path, missing commands
+static const char *lines[] = {
+    "cd dir1 && cd -",
+    "{ cd dir2; cd ..; } || cd /",
+    "cat src1.txt >dst.txt",
+    "cat src*.txt >>dst.txt",
+    "<src2.txt >dst.txt",
+    "j dir1",
+    "jobstats cpu 1",
+    "cd nowhere; cd dir1/../dir2 && cd ..",
+    "no_such_command arg \"quoted arg\" 'single'",
+    "cat missing.txt >dst.txt || cd .",
+};
+
+// lines that fork: pipelines, substitutions and background jobs
+static const char *forking_lines[] = {
+    "true | true && false || true",
+    "cat \"$(echo src1.txt)\" $(echo src2.txt) >dst.txt",
+    "true &",
+    "cat <<<here-string",
+};
+
+static const char *completions[] = {"c", "ca", "jobst", "no_such_prefix"};
+
+static long rss_kb() {
+    long pages = 0, resident = 0;
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (f == NULL)
+        return 0;
+    if (fscanf(f, "%ld %ld", &pages, &resident) != 2)
+        resident = 0;
+    fclose(f);
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static void write_file(const char *name, const char *data) {
+    int fd = open(name, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    if (fd != -1) {
+        write(fd, data, strlen(data));
+        close(fd);
+    }
+}
+
+static void run_line(const char *line) {
+    char buf[4096];
+    struct command_t *command = calloc(1, sizeof(struct command_t));
+    snprintf(buf, sizeof(buf), "%s", line);
+    parse_line(buf, command);
+    run_list(command);
+    free_command(command);
+}
+
+static void complete(long i) {
+    char cmd[32];
+    snprintf(cmd, sizeof(cmd), "%s", completions[i % (sizeof(completions) / sizeof(completions[0]))]);
+    free(onematch(cmd));
+    freeListOfMatchingCommands(getListOfMatchingCommands(cmd));
+}
+
+static void remove_root() {
+    const char *files[] = {"src1.txt", "src2.txt", "dst.txt", ".shellgibi_dirs", "shellgibi/commands"};
+    chdir(root);
+    for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++)
+        unlink(files[i]);
+    rmdir("shellgibi");
+    rmdir("dir1");
+    rmdir("dir2");
+    chdir("/");
+    rmdir(root);
+}
+
+int main(int argc, char *argv[]) {
+    long runs = argc > 1 ? atol(argv[1]) : SOAK_RUNS;
+    if (runs <= 0 || mkdtemp(root) == NULL) {
+        fprintf(stderr, "usage: %s [runs]\n", argv[0]);
+        return 2;
+    }
+    chdir(root);
+    mkdir("dir1", S_IRWXU);
+    mkdir("dir2", S_IRWXU);
+    write_file("src1.txt", "first source\n");
+    write_file("src2.txt", "second source\n");
+    setenv("HOME", root, 1);
+    setenv("XDG_CACHE_HOME", root, 1);
+    PATH = getenv("PATH");
+    USER = getenv("USER");
+
+    // what the commands print goes nowhere, the report goes to the real stderr
+    int report_fd = dup(STDERR_FILENO);
+    int null_fd = open("/dev/null", O_WRONLY);
+    dup2(null_fd, STDOUT_FILENO);
+    dup2(null_fd, STDERR_FILENO);
+    close(null_fd);
+
+    long warmup = runs / SOAK_WARMUP_DIVISOR, base = 0, peak = 0;
+    for (long i = 0; i < runs; i++) {
+        if (i == warmup)
+            base = rss_kb();
+        size_t forking = sizeof(forking_lines) / sizeof(forking_lines[0]), n = sizeof(lines) / sizeof(lines[0]);
+        if (i % SOAK_FORK_EVERY == SOAK_FORK_EVERY - 1)
+            run_line(forking_lines[(i / SOAK_FORK_EVERY) % forking]);
+        else
+            run_line(lines[i % n]);
+        complete(i);
+        reap_background_jobs();
+        fflush(stdout);
+        chdir(root); // whatever a line left the directory as
+        if (i >= warmup && i % 10000 == 0) {
+            long rss = rss_kb();
+            if (rss > peak) peak = rss;
+        }
+    }
+    long end = rss_kb();
+    if (end > peak) peak = end;
+
+    dup2(report_fd, STDERR_FILENO); // for the leak checker's report at exit too
+    close(report_fd);
+    long growth = peak - base;
+    fprintf(stderr, "%ld runs: rss %ld KB after warmup, %ld KB peak, %ld KB at the end, grew %ld KB (limit %d KB)\n",
+            runs, base, peak, end, growth, SOAK_MAX_GROWTH_KB);
+    remove_root();
+    return SOAK_MAX_GROWTH_KB >= 0 && growth > SOAK_MAX_GROWTH_KB ? 1 : 0;
+}
@@ -0,0 +1,315 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "shellgibi.h"
+
+// "did you mean" suggestions from a BK-tree over PATH commands and builtins
+#define SUGGEST_MAX 3
+#define SUGGEST_MAX_LEN 255
+
+struct bk_node {
+    int word;               // offset in words
+    int dist;               // edit distance to the parent
+    int child, sibling;     // first child and next sibling, -1 if none
+    int refs;               // how many PATH directories have it, 0 means removed
+};
+
+struct path_dir {
+    char *path;
+    struct timespec mtime;
+    int *names;             // nodes of the commands in it
+    int name_count;
+    bool seen;              // still in PATH
+};
+
+static struct bk_node *nodes;
+static int node_count, node_cap, dead_nodes;
+static char *words;
+static size_t words_len, words_cap;
+static struct path_dir *dirs;
+static int dir_count;
+static char *indexed_path;
+static bool index_checked; // the PATH directories were stat'ed since the last prompt
+static const char *builtins[] = {"cd", "exit", "todo"}; // builtins not in userMethods
+
+static int edit_distance(const char *a, const char *b) {
+    int la = strlen(a), lb = strlen(b);
+    if (la > SUGGEST_MAX_LEN) la = SUGGEST_MAX_LEN;
+    if (lb > SUGGEST_MAX_LEN) lb = SUGGEST_MAX_LEN;
+    int row[SUGGEST_MAX_LEN + 1];
+    for (int j = 0; j <= lb; j++)
+        row[j] = j;
+    for (int i = 1; i <= la; i++) {
+        int diag = row[0];
+        row[0] = i;
+        for (int j = 1; j <= lb; j++) {
+            int up = row[j];
+            int best = diag + (a[i - 1] != b[j - 1]);
+            if (up + 1 < best) best = up + 1;
+            if (row[j - 1] + 1 < best) best = row[j - 1] + 1;
+            row[j] = best;
+            diag = up;
+        }
+    }
+    return row[lb];
+}
+
+/**
+ * Edit distance that counts swapping two neighbours as one edit. It is not a
+ * metric, so the tree is built on edit_distance and this only ranks the hits.
+ */
+static int swap_distance(const char *a, const char *b) {
+    int la = strlen(a), lb = strlen(b);
+    if (la > SUGGEST_MAX_LEN) la = SUGGEST_MAX_LEN;
+    if (lb > SUGGEST_MAX_LEN) lb = SUGGEST_MAX_LEN;
+    int rows[3][SUGGEST_MAX_LEN + 1];
+    int *prev2 = rows[0], *prev = rows[1], *cur = rows[2];
+    for (int j = 0; j <= lb; j++)
+        prev[j] = j;
+    for (int i = 1; i <= la; i++) {
+        cur[0] = i;
+        for (int j = 1; j <= lb; j++) {
+            int best = prev[j - 1] + (a[i - 1] != b[j - 1]);
+            if (prev[j] + 1 < best) best = prev[j] + 1;
+            if (cur[j - 1] + 1 < best) best = cur[j - 1] + 1;
+            if (i > 1 && j > 1 && a[i - 1] == b[j - 2] && a[i - 2] == b[j - 1] && prev2[j - 2] + 1 < best)
+                best = prev2[j - 2] + 1;
+            cur[j] = best;
+        }
+        int *t = prev2;
+        prev2 = prev;
+        prev = cur;
+        cur = t;
+    }
+    return prev[lb];
+}
+
+static int new_node(const char *word, int dist) {
+    size_t len = strlen(word) + 1;
+    if (words_len + len > words_cap) {
+        while (words_len + len > words_cap)
+            words_cap = words_cap ? words_cap * 2 : 64 * 1024;
+        words = realloc(words, words_cap);
+    }
+    memcpy(words + words_len, word, len);
+
+    if (node_count == node_cap) {
+        node_cap = node_cap ? node_cap * 2 : 1024;
+        nodes = realloc(nodes, sizeof(struct bk_node) * node_cap);
+    }
+    struct bk_node *n = &nodes[node_count];
+    n->word = words_len;
+    n->dist = dist;
+    n->child = n->sibling = -1;
+    n->refs = 0;
+    dead_nodes++; // until bk_add references it
+    words_len += len;
+    return node_count++;
+}
+
+/**
+ * Add a reference to a word, inserting it if the tree doesn't have it
+ * @return its node
+ */
+static int bk_add(const char *word) {
+    int i = 0;
+    if (node_count == 0)
+        i = new_node(word, 0);
+    while (1) {
+        int d = edit_distance(word, words + nodes[i].word);
+        if (d == 0)
+            break;
+        int c = nodes[i].child;
+        while (c != -1 && nodes[c].dist != d)
+            c = nodes[c].sibling;
+        if (c == -1) {
+            c = new_node(word, d);
+            nodes[c].sibling = nodes[i].child;
+            nodes[i].child = c;
+        }
+        i = c;
+    }
+    if (nodes[i].refs++ == 0)
+        dead_nodes--;
+    return i;
+}
+
+static void bk_release(int i) {
+    if (--nodes[i].refs == 0)
+        dead_nodes++;
+}
+
+struct suggestion {
+    int node, dist;
+};
+
+static void bk_search(int i, const char *word, int max, struct suggestion *best, int *count) {
+    int d = edit_distance(word, words + nodes[i].word);
+    if (d <= max && nodes[i].refs > 0) {
+        // keep the SUGGEST_MAX closest, sorted
+        int rank = swap_distance(word, words + nodes[i].word);
+        int pos = *count < SUGGEST_MAX ? (*count)++ : SUGGEST_MAX;
+        while (pos > 0 && best[pos - 1].dist > rank) {
+            if (pos < SUGGEST_MAX) best[pos] = best[pos - 1];
+            pos--;
+        }
+        if (pos < SUGGEST_MAX) {
+            best[pos].node = i;
+            best[pos].dist = rank;
+        }
+    }
+    // the triangle inequality rules out every child further than max from d
+    for (int c = nodes[i].child; c != -1; c = nodes[c].sibling)
+        if (nodes[c].dist >= d - max && nodes[c].dist <= d + max)
+            bk_search(c, word, max, best, count);
+}
+
+static void scan_dir(struct path_dir *dir) {
+    for (int i = 0; i < dir->name_count; i++)
+        bk_release(dir->names[i]);
+    dir->name_count = 0;
+
+    DIR *dr = opendir(dir->path);
+    if (dr == NULL)
+        return;
+    int cap = 0;
+    struct dirent *de;
+    while ((de = readdir(dr)) != NULL) {
+        if (de->d_name[0] == '.' || de->d_type == DT_DIR)
+            continue;
+        if (dir->name_count == cap) {
+            cap = cap ? cap * 2 : 256;
+            dir->names = realloc(dir->names, sizeof(int) * cap);
+        }
+        dir->names[dir->name_count++] = bk_add(de->d_name);
+    }
+    closedir(dr);
+}
+
+static void free_index() {
+    for (int i = 0; i < dir_count; i++) {
+        free(dirs[i].path);
+        free(dirs[i].names);
+    }
+    free(dirs);
+    free(nodes);
+    free(words);
+    free(indexed_path);
+    dirs = NULL;
+    nodes = NULL;
+    words = NULL;
+    indexed_path = NULL;
+    dir_count = node_count = node_cap = dead_nodes = 0;
+    words_len = words_cap = 0;
+}
+
+/** a new prompt line: the next lookup stats the PATH directories again */
+void expire_command_index() {
+    index_checked = false;
+}
+
+/**
+ * Bring the index up to date: only directories that left or joined PATH,
+ * or whose mtime changed, are read again. Once per prompt, the lookups after
+ * the first one of a line trust it.
+ */
+void refresh_command_index() {
+    if (PATH == NULL)
+        return;
+    if (index_checked && indexed_path != NULL && strcmp(indexed_path, PATH) == 0)
+        return;
+    if (dead_nodes > node_count / 2) // removed commands only get marked, start over once they pile up
+        free_index();
+
+    if (node_count == 0) {
+        for (int i = 0; i < NUMUSERMETHODS; i++)
+            bk_add(userMethods[i]);
+        for (size_t i = 0; i < sizeof(builtins) / sizeof(builtins[0]); i++)
+            bk_add(builtins[i]);
+    }
+
+    bool path_changed = indexed_path == NULL || strcmp(indexed_path, PATH) != 0;
+    if (path_changed) {
+        for (int i = 0; i < dir_count; i++)
+            dirs[i].seen = false;
+        char *pathCopy = strdup(PATH);
+        for (char *token = strtok(pathCopy, ":"); token; token = strtok(NULL, ":")) {
+            int i;
+            for (i = 0; i < dir_count && strcmp(dirs[i].path, token) != 0; i++);
+            if (i == dir_count) {
+                dirs = realloc(dirs, sizeof(struct path_dir) * ++dir_count);
+                memset(&dirs[i], 0, sizeof(struct path_dir));
+                dirs[i].path = strdup(token);
+                dirs[i].mtime.tv_nsec = -1; // never read
+            }
+            dirs[i].seen = true;
+        }
+        free(pathCopy);
+
+        for (int i = 0; i < dir_count; i++) {
+            if (dirs[i].seen)
+                continue;
+            for (int j = 0; j < dirs[i].name_count; j++)
+                bk_release(dirs[i].names[j]);
+            free(dirs[i].path);
+            free(dirs[i].names);
+            dirs[i--] = dirs[--dir_count];
+        }
+        free(indexed_path);
+        indexed_path = strdup(PATH);
+    }
+
+    for (int i = 0; i < dir_count; i++) {
+        struct stat st;
+        if (stat(dirs[i].path, &st) == -1) {
+            st.st_mtim.tv_sec = 0;
+            st.st_mtim.tv_nsec = 0;
+        }
+        if (st.st_mtim.tv_sec != dirs[i].mtime.tv_sec || st.st_mtim.tv_nsec != dirs[i].mtime.tv_nsec) {
+            dirs[i].mtime = st.st_mtim;
+            scan_dir(&dirs[i]);
+        }
+    }
+    index_checked = true;
+}
+
+/**
+ * Find the known commands closest to a name
+ * @param  name     [description]
+ * @param  out      filled with up to max pointers into the index, valid until the next refresh
+ * @param  max      [description]
+ * @return          number of suggestions
+ */
+int suggest_commands(const char *name, const char **out, int max) {
+    refresh_command_index();
+    if (node_count == 0)
+        return 0;
+    int len = strlen(name);
+    int tolerance = len <= 2 ? 1 : 2;
+    struct suggestion best[SUGGEST_MAX];
+    int count = 0;
+    bk_search(0, name, tolerance, best, &count);
+    if (count > max) count = max;
+    for (int i = 0; i < count; i++)
+        out[i] = words + nodes[best[i].node].word;
+    return count;
+}
+
+/**
+ * Tell the user a command doesn't exist, with suggestions if there are close ones
+ */
+void command_not_found(const char *name) {
+    const char *matches[SUGGEST_MAX];
+    fflush(stdout); // stderr, so $(typo) doesn't capture it, but after what was printed before
+    fprintf(stderr, "-%s: %s: command not found\n", sysname, name);
+    int n = suggest_commands(name, matches, SUGGEST_MAX);
+    if (n == 0)
+        return;
+    fprintf(stderr, "did you mean:");
+    for (int i = 0; i < n; i++)
+        fprintf(stderr, " %s", matches[i]);
+    fprintf(stderr, "?\n");
+}
@@ -0,0 +1,278 @@
+#include <unistd.h>
+#include <sys/wait.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+
+#include "shellgibi.h"
+
+// for xargs
+#define XARGS_HEADROOM 2048         // what POSIX asks xargs to leave free below ARG_MAX
+#define XARGS_READ_SIZE (64 * 1024)
+
+extern char **environ;
+
+struct xargs_batch {
+    const char *path;           // resolved once for all batches
+    char **fixed;               // argv[0] and the arguments given to xargs
+    int fixed_count;
+    size_t fixed_bytes;
+    char *area;                 // item strings, packed
+    size_t used, limit;
+    size_t *items;              // offsets of the items in area
+    int count, cap, max_items;
+    pid_t *running;
+    int running_count, parallel;
+    int out_fd;                 // > or >> of the xargs command or the pipe to the next stage, -1 if none
+    int status;                 // of xargs as a whole, from how the batches went
+    pid_t next_pid;             // the rest of the pipeline, -1 if none or reaped
+    int next_status;
+};
+
+static size_t environ_bytes() {
+    size_t bytes = sizeof(char *);
+    for (char **e = environ; *e; e++)
+        bytes += strlen(*e) + 1 + sizeof(char *);
+    return bytes;
+}
+
+/**
+ * Fold a batch's wait status into xargs' own like xargs does: 123 if a run failed, 125 if one was
+ * killed, 126 or 127 if the command couldn't be run, the worst of them wins
+ */
+static void xargs_record(struct xargs_batch *b, int status) {
+    int code = exit_status(status), result = 0;
+    if (WIFSIGNALED(status))
+        result = 125;
+    else if (code == 126 || code == 127)
+        result = code;
+    else if (code != 0)
+        result = 123;
+    if (result > b->status)
+        b->status = result;
+}
+
+/** wait until one of our batches is done */
+static void xargs_wait_one(struct xargs_batch *b) {
+    while (b->running_count > 0) {
+        int status;
+        pid_t pid = wait_any_job(&status);
+        if (pid == -1)
+            break;
+        if (pid == b->next_pid) { // the next stage quit before reading everything, like head does
+            b->next_status = status;
+            b->next_pid = -1;
+            continue;
+        }
+        for (int i = 0; i < b->running_count; i++) {
+            if (b->running[i] == pid) {
+                b->running[i] = b->running[--b->running_count];
+                xargs_record(b, status);
+                return;
+            }
+        }
+    }
+}
+
+/**
+ * Run the command with the packed items, keeping at most b->parallel running
+ * @param keep bytes at the end of the area that belong to an item still being read
+ */
+static void xargs_flush(struct xargs_batch *b, size_t keep) {
+    if (b->count == 0)
+        return;
+    while (b->running_count >= b->parallel)
+        xargs_wait_one(b);
+
+    char **argv = malloc(sizeof(char *) * (b->fixed_count + b->count + 1));
+    memcpy(argv, b->fixed, sizeof(char *) * b->fixed_count);
+    for (int i = 0; i < b->count; i++)
+        argv[b->fixed_count + i] = b->area + b->items[i];
+    argv[b->fixed_count + b->count] = NULL;
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        if (b->out_fd != -1) // first, it may have taken fd 0
+            dup2(b->out_fd, STDOUT_FILENO);
+        int devnull = open("/dev/null", O_RDONLY); // the items are ours, not the command's
+        dup2(devnull, STDIN_FILENO);
+        close(devnull);
+        execv(b->path, argv);
+        exec_failed(b->fixed[0]);
+    }
+    free(argv);
+    if (pid > 0) {
+        struct command_t job = {0};
+        job.name = b->fixed[0];
+        job_started(pid, &job);
+        b->running[b->running_count++] = pid;
+    }
+
+    // the child has its own copy, the area can be reused right away
+    memmove(b->area, b->area + b->used - keep, keep);
+    b->used = keep;
+    b->count = 0;
+}
+
+/** bytes the next exec will need if one more item of len bytes is added */
+static size_t xargs_size(struct xargs_batch *b, size_t len) {
+    return b->fixed_bytes + b->used + len + 1 + sizeof(char *) * (b->count + 2);
+}
+
+/**
+ * xargs [-0] [-n max] [-P procs] cmd args...: run cmd with as many items from stdin
+ * as fit under ARG_MAX per invocation, optionally several at a time
+ */
+int xargs(struct command_t *command, int in_fd) {
+    struct xargs_batch b = {0};
+    bool nul = false;
+    int first = 0;
+    b.parallel = 1;
+    b.max_items = 0;
+    while (first < command->arg_count && command->args[first][0] == '-') {
+        char *opt = command->args[first];
+        if (strcmp(opt, "-0") == 0) {
+            nul = true;
+            first++;
+        } else if ((strcmp(opt, "-P") == 0 || strcmp(opt, "-n") == 0) && first + 1 < command->arg_count) {
+            int v = atoi(command->args[first + 1]);
+            if (opt[1] == 'P') b.parallel = v > 0 ? v : 1;
+            else b.max_items = v > 0 ? v : 0;
+            first += 2;
+        } else {
+            printf("usage: xargs [-0] [-n max] [-P procs] cmd args...\n");
+            return SUCCESS;
+        }
+    }
+
+    char *name = first < command->arg_count ? command->args[first] : "echo";
+    b.path = resolve_command(name);
+    if (b.path == NULL) {
+        command_not_found(name);
+        last_status = 127;
+        return UNKNOWN;
+    }
+    b.fixed_count = first < command->arg_count ? command->arg_count - first : 1;
+    b.fixed = first < command->arg_count ? command->args + first : &name;
+    for (int i = 0; i < b.fixed_count; i++)
+        b.fixed_bytes += strlen(b.fixed[i]) + 1 + sizeof(char *);
+
+    long arg_max = sysconf(_SC_ARG_MAX);
+    if (arg_max <= 0) arg_max = 128 * 1024;
+    long room = arg_max - (long) environ_bytes() - (long) b.fixed_bytes - XARGS_HEADROOM;
+    if (room < 4096) {
+        printf("-%s: xargs: environment too large for any arguments\n", sysname);
+        free((char *) b.path);
+        last_status = 1;
+        return SUCCESS;
+    }
+
+    // the rest of the pipeline reads what the batches print, unless > sends that to a file
+    int pipe_fd = -1;
+    b.next_pid = -1;
+    if (command->next != NULL && (b.next_pid = launch_next(command->next, &pipe_fd)) == -1) {
+        printf("-%s: xargs: %s\n", sysname, strerror(errno));
+        free((char *) b.path);
+        last_status = 1;
+        return SUCCESS;
+    }
+    b.limit = arg_max - environ_bytes() - XARGS_HEADROOM;
+    b.area = malloc(room);
+    b.cap = 1024;
+    b.items = malloc(sizeof(size_t) * b.cap);
+    b.running = malloc(sizeof(pid_t) * b.parallel);
+
+    // every batch writes to the same open file, so > truncates once
+    b.out_fd = -1;
+    if (command->redirects[1] != NULL)
+        b.out_fd = open(command->redirects[1], O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    else if (command->redirects[2] != NULL)
+        b.out_fd = open(command->redirects[2], O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    else if (pipe_fd != -1)
+        b.out_fd = pipe_fd;
+    if (pipe_fd != -1 && b.out_fd != pipe_fd)
+        close(pipe_fd);
+
+    int fd = in_fd;
+    if (command->heredoc > 0)
+        fd = command->heredoc;
+    else if (command->redirects[0] != NULL && (fd = open(command->redirects[0], O_RDONLY)) == -1) {
+        printf("-%s: %s: %s\n", sysname, command->redirects[0], strerror(errno));
+        fd = in_fd;
+        room = 0; // nothing to read
+        b.status = 1;
+    }
+
+    char *buf = malloc(XARGS_READ_SIZE);
+    bool in_item = false, skipping = false;
+    size_t item_start = 0;
+    ssize_t n;
+    while (room > 0 && ((n = read(fd, buf, XARGS_READ_SIZE)) > 0 || (n == -1 && errno == EINTR))) {
+        for (ssize_t i = 0; i < n; i++) {
+            char c = buf[i];
+            bool separator = nul ? c == 0 : (c == ' ' || c == '\t' || c == '\n');
+            if (separator) {
+                skipping = false;
+                if (!in_item)
+                    continue;
+                b.area[b.used++] = 0;
+                if (b.count == b.cap) {
+                    b.cap *= 2;
+                    b.items = realloc(b.items, sizeof(size_t) * b.cap);
+                }
+                b.items[b.count++] = item_start;
+                in_item = false;
+                if (b.count == b.max_items)
+                    xargs_flush(&b, 0);
+                continue;
+            }
+            if (skipping)
+                continue;
+            if (!in_item) {
+                item_start = b.used;
+                in_item = true;
+            }
+            if (xargs_size(&b, 1) > b.limit) { // the item being read won't fit, run what we have
+                size_t partial = b.used - item_start;
+                if (b.count == 0) {
+                    printf("-%s: xargs: argument too long, skipped\n", sysname);
+                    b.used = item_start;
+                    in_item = false;
+                    skipping = true;
+                    continue;
+                }
+                xargs_flush(&b, partial);
+                item_start = 0;
+            }
+            b.area[b.used++] = c;
+        }
+    }
+    if (in_item) {
+        b.area[b.used++] = 0;
+        if (b.count == b.cap) {
+            b.cap *= 2;
+            b.items = realloc(b.items, sizeof(size_t) * b.cap);
+        }
+        b.items[b.count++] = item_start;
+    }
+    xargs_flush(&b, 0);
+    while (b.running_count > 0)
+        xargs_wait_one(&b);
+
+    if (fd != in_fd && fd != command->heredoc)
+        close(fd);
+    if (b.out_fd != -1)
+        close(b.out_fd); // the next stage sees the end of its input
+    if (b.next_pid > 0)
+        b.next_status = wait_job(b.next_pid);
+    free(buf);
+    free(b.area);
+    free(b.items);
+    free(b.running);
+    free((char *) b.path);
+    last_status = command->next != NULL ? exit_status(b.next_status) : b.status; // a pipeline's is its last stage's
+    return SUCCESS;
+}